@@ -0,0 +1,133 @@
+#ifndef ADAPTIVE_STOP_H
+#define ADAPTIVE_STOP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+// --- ОЦЕНКА УСПЕХА АТАКИ И АДАПТИВНАЯ ОСТАНОВКА (по Сельчуку) ---
+//
+// Атака ранжирует кандидатов ключа; преимущество a бит означает, что
+// истинный ключ попадает в лучшие 2^{-a} * (число кандидатов).
+// Для объема данных N и целевой вероятности успеха P_S Сельчук дает:
+//   дифференциальная:  Phi^{-1}(1 - 2^{-a}) = sqrt(mu * S) - Phi^{-1}(P_S) * sqrt(S + 1),
+//                      mu = p * N (ожидаемые попадания), S = p / q (сигнал/шум);
+//   линейная:          Phi^{-1}(1 - 2^{-a-1}) = 2 * sqrt(N) * |eps| - Phi^{-1}(P_S).
+// Параметры p, q и eps оцениваются по текущей таблице счетчиков:
+// лидер — лучшая группа кандидатов с одинаковым счетом (на этих данных
+// статистика их не различает, хотя другая — например, усеченная —
+// может), остальные — шум. Пока лидеров L из n, истинный ключ известен
+// лишь с точностью до группы: преимущество не больше log2(n / L), и
+// цель выше этой границы не считается достигнутой.
+// Генерация останавливается, как только достижимое преимущество не
+// меньше цели.
+
+inline double normalCdf(double x) { return 0.5 * std::erfc(-x / std::sqrt(2.0)); }
+
+// Phi^{-1}(p) бисекцией (точности 1e-10 хватает для оценки)
+inline double normalQuantile(double p) {
+    if (p <= 0) return -40.0;
+    if (p >= 1) return 40.0;
+    double lo = -40.0, hi = 40.0;
+    for (int i = 0; i < 200 && hi - lo > 1e-10; ++i) {
+        double mid = 0.5 * (lo + hi);
+        if (normalCdf(mid) < p) lo = mid;
+        else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+// a из Phi^{-1}(1 - 2^{-a}) = x; 0, если x не положителен
+inline double advantageFromQuantile(double x) {
+    if (x <= 0) return 0.0;
+    double tail = 0.5 * std::erfc(x / std::sqrt(2.0)); // 1 - Phi(x) без потери точности
+    if (tail <= 0) return 64.0;
+    return -std::log2(tail);
+}
+
+// Достижимое преимущество дифференциальной атаки
+inline double differentialAdvantage(double p, double q, double N, double successProb) {
+    if (p <= 0 || q <= 0 || p <= q) return 0.0;
+    double S = p / q;
+    return advantageFromQuantile(std::sqrt(p * N * S) - normalQuantile(successProb) * std::sqrt(S + 1));
+}
+
+// Достижимое преимущество линейной атаки
+inline double linearAdvantage(double eps, double N, double successProb) {
+    double a = advantageFromQuantile(2 * std::sqrt(N) * std::fabs(eps) - normalQuantile(successProb));
+    return std::max(0.0, a - 1.0);
+}
+
+// Объем данных для заданного преимущества (обратная формула Сельчука)
+inline double differentialDataComplexity(double p, double q, double advantage, double successProb) {
+    if (p <= 0 || q <= 0 || p <= q) return INFINITY;
+    double S = p / q;
+    double t = normalQuantile(1 - std::pow(2.0, -advantage)) + normalQuantile(successProb) * std::sqrt(S + 1);
+    return t * t / (S * p);
+}
+
+inline double linearDataComplexity(double eps, double advantage, double successProb) {
+    if (eps == 0) return INFINITY;
+    double t = normalQuantile(1 - std::pow(2.0, -advantage - 1)) + normalQuantile(successProb);
+    return t * t / (4 * eps * eps);
+}
+
+// Предел преимущества при ничьей L кандидатов из n
+inline double tieAdvantageBound(int numCand, int leaders) {
+    return leaders > 0 ? std::log2((double)numCand / leaders) : 0.0;
+}
+
+struct AdaptiveEstimate {
+    int leaders = 0;        // кандидатов в группе лидера
+    double p = 0;           // оценка вероятности попадания для лидера
+    double q = 0;           // средняя для остальных
+    double eps = 0;         // смещение лидера (линейная атака)
+    double advantage = 0;   // достижимое преимущество, бит
+    double needed = 0;      // оценка нужного объема данных для цели (INFINITY — недостижима при ничьей)
+};
+
+struct AdaptiveStop {
+    double targetAdvantage = 3.0; // бит
+    double successProb = 0.99;
+    long long minPairs = 64;      // до этого объема оценкам не верим
+    long long minHits = 8;        // и до стольких попаданий лидера (как запас 8/P)
+
+    // scores — попадания кандидатов после N пар
+    bool differential(const long long* scores, int numCand, long long N, AdaptiveEstimate& e) const {
+        long long best = *std::max_element(scores, scores + numCand);
+        long long rest = 0;
+        e.leaders = 0;
+        for (int k = 0; k < numCand; ++k) {
+            if (scores[k] == best) e.leaders++;
+            else rest += scores[k];
+        }
+        int others = numCand - e.leaders;
+        e.p = (double)best / N;
+        // Поправка Лапласа: шум не бывает нулевым
+        e.q = others ? (rest + 1.0) / ((double)others * N + 2.0) : e.p;
+        double bound = tieAdvantageBound(numCand, e.leaders);
+        e.advantage = std::min(differentialAdvantage(e.p, e.q, (double)N, successProb), bound);
+        e.needed = targetAdvantage > bound ? INFINITY
+                                           : differentialDataComplexity(e.p, e.q, targetAdvantage, successProb);
+        return N >= minPairs && best >= minHits && e.advantage >= targetAdvantage;
+    }
+
+    // matches — число выполнений уравнения для кандидатов после N пар
+    bool linear(const long long* matches, int numCand, long long N, AdaptiveEstimate& e) const {
+        double bestDev = -1;
+        for (int k = 0; k < numCand; ++k)
+            bestDev = std::max(bestDev, std::fabs(matches[k] - N / 2.0));
+        e.leaders = 0;
+        for (int k = 0; k < numCand; ++k)
+            if (std::fabs(matches[k] - N / 2.0) == bestDev) e.leaders++;
+        e.eps = bestDev / N;
+        double bound = tieAdvantageBound(numCand, e.leaders);
+        e.advantage = std::min(linearAdvantage(e.eps, (double)N, successProb), bound);
+        e.needed = targetAdvantage > bound ? INFINITY
+                                           : linearDataComplexity(e.eps, targetAdvantage, successProb);
+        return N >= minPairs && e.advantage >= targetAdvantage;
+    }
+};
+
+#endif // ADAPTIVE_STOP_H
@@ -0,0 +1,245 @@
+#ifndef BITSLICE_H
+#define BITSLICE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+
+// --- БИТСЛАЙС-ДВИЖОК (пакетное шифрование) ---
+//
+// Состояние пакета хранится как 16 битовых плоскостей: плоскость p содержит
+// бит p упакованного блока (packBlock) для каждой "линии" (lane).
+// Ниббл x[i] занимает плоскости (3-i)*4 .. (3-i)*4+3:
+//   x3 -> 0..3, x2 -> 4..7, x1 -> 8..11, x0 -> 12..15.
+//
+// Ширина пакета задается типом слова W:
+//   uint64_t -> 64 блока   (переносимый вариант)
+//   bs256_t  -> 256 блоков (AVX2 при -mavx2)
+//   bs512_t  -> 512 блоков (AVX-512 при -mavx512f)
+// Векторные типы — расширения GCC/Clang, без -m флагов они просто
+// раскладываются на более узкие инструкции.
+
+typedef uint64_t bs64_t;
+typedef uint64_t bs256_t __attribute__((vector_size(32)));
+typedef uint64_t bs512_t __attribute__((vector_size(64)));
+
+#if defined(__AVX512F__)
+typedef bs512_t bs_native_t;
+#elif defined(__AVX2__)
+typedef bs256_t bs_native_t;
+#else
+typedef bs64_t bs_native_t;
+#endif
+
+template <typename W>
+struct BsTraits {
+    static constexpr int WORDS = sizeof(W) / sizeof(uint64_t);
+    static constexpr int LANES = WORDS * 64;
+};
+
+// Доступ к 64-битному слову номер i внутри W
+template <typename W>
+inline void bsSetWord(W& w, int i, uint64_t v) { w[i] = v; }
+inline void bsSetWord(bs64_t& w, int, uint64_t v) { w = v; }
+template <typename W>
+inline uint64_t bsGetWord(const W& w, int i) { return w[i]; }
+inline uint64_t bsGetWord(const bs64_t& w, int) { return w; }
+
+// Нулевое и единичное слово пишутся по ссылке: функция, возвращающая
+// векторный тип, без -mavx* вызывает у GCC предупреждение о смене ABI
+// (-Wpsabi), которое не подавить pragma в заголовке — шаблоны
+// инстанцируются в конце единицы трансляции.
+template <typename W>
+inline void bsSetZero(W& w) { w = W{}; }
+
+template <typename W>
+inline void bsSetOnes(W& w) { w = ~W{}; }
+
+// --- S-BOX КАК БУЛЕВА СХЕМА ---
+
+// Алгебраическая нормальная форма (ANF) каждого выходного бита S-Box.
+// anf[j] бит u = 1, если моном x^u (произведение входных бит из u)
+// входит в выходной бит j. Считается преобразованием Мёбиуса.
+struct SboxAnf {
+    uint16_t anf[4];
+};
+
+constexpr SboxAnf computeSboxAnf(const uint8_t (&sbox)[16]) {
+    SboxAnf r{};
+    for (int j = 0; j < 4; ++j) {
+        uint8_t t[16] = {};
+        for (int x = 0; x < 16; ++x) t[x] = (sbox[x] >> j) & 1;
+        for (int step = 1; step < 16; step <<= 1)
+            for (int x = 0; x < 16; ++x)
+                if (x & step) t[x] ^= t[x ^ step];
+        uint16_t m = 0;
+        for (int u = 0; u < 16; ++u) m |= (uint16_t)(t[u] << u);
+        r.anf[j] = m;
+    }
+    return r;
+}
+
+constexpr SboxAnf SBOX_ANF = computeSboxAnf(SBOX);
+
+// G над плоскостями: in[0..3] — биты входа (младший первый), out[0..3] — выход.
+// 11 AND для мономов + XOR по маскам ANF (для SBOX_ANF маски — константы,
+// ветки сворачиваются; другой S-Box передается своей ANF).
+template <typename W>
+inline void bsG(const W in[4], W out[4], const SboxAnf& anf = SBOX_ANF) {
+    W m[16];
+    bsSetOnes(m[0]);
+    for (int u = 1; u < 16; ++u) {
+        int low = u & -u;
+        int lowBit = __builtin_ctz(u);
+        m[u] = (u == low) ? in[lowBit] : (m[low] & m[u ^ low]);
+    }
+    for (int j = 0; j < 4; ++j) {
+        W acc;
+        bsSetZero(acc);
+        for (int u = 0; u < 16; ++u)
+            if ((anf.anf[j] >> u) & 1) acc ^= m[u];
+        out[j] = acc;
+    }
+}
+
+// Один раунд над плоскостями: temp = x0 ^ G(x2 ^ G(k ^ x3)); сдвиг влево.
+template <typename W>
+inline void bsRound(W s[16], uint8_t k, const SboxAnf& anf = SBOX_ANF) {
+    W in[4], t[4], u[4];
+    for (int j = 0; j < 4; ++j)
+        in[j] = ((k >> j) & 1) ? ~s[j] : s[j];
+    bsG(in, t, anf);
+    for (int j = 0; j < 4; ++j) in[j] = s[4 + j] ^ t[j];
+    bsG(in, u, anf);
+
+    W temp[4];
+    for (int j = 0; j < 4; ++j) temp[j] = s[12 + j] ^ u[j];
+    for (int p = 15; p >= 4; --p) s[p] = s[p - 4];
+    for (int j = 0; j < 4; ++j) s[j] = temp[j];
+}
+
+// rounds раундов спецификации (не больше MAX_ROUNDS, как CipherSpec::encrypt).
+// S-Box Варианта 5 идет константной схемой, другой — своей ANF.
+template <typename W>
+inline void bsEncryptRounds(W s[16], const CipherSpec& spec, int rounds) {
+    if (rounds > MAX_ROUNDS) rounds = MAX_ROUNDS;
+    if (memcmp(spec.sbox, SBOX, 16) == 0) {
+        for (int r = 0; r < rounds; ++r) bsRound(s, spec.roundKeys[r]);
+    } else {
+        const SboxAnf anf = computeSboxAnf(spec.sbox);
+        for (int r = 0; r < rounds; ++r) bsRound(s, spec.roundKeys[r], anf);
+    }
+}
+
+// --- ТРАНСПОНИРОВАНИЕ ---
+
+// 64 блока <-> 16 плоскостей по 64 бита.
+// Слово w[r] держит блоки r, r+16, r+32, r+48 в своих 16-битных полях;
+// транспонирование 16x16 выполняется сразу во всех четырех полях (SWAR).
+// После него w[b] содержит бит b всех 64 блоков, бит L = блок L.
+// Преобразование — инволюция, поэтому используется и для обратного хода.
+inline void bsTranspose16x4(uint64_t w[16]) {
+    static const uint64_t MASKS[4] = {
+        0x00FF00FF00FF00FFULL, 0x0F0F0F0F0F0F0F0FULL,
+        0x3333333333333333ULL, 0x5555555555555555ULL
+    };
+    int mi = 0;
+    for (int j = 8; j != 0; j >>= 1, ++mi) {
+        uint64_t m = MASKS[mi];
+        for (int k = 0; k < 16; k = ((k | j) + 1) & ~j) {
+            uint64_t t = ((w[k] >> j) ^ w[k + j]) & m;
+            w[k] ^= t << j;
+            w[k + j] ^= t;
+        }
+    }
+}
+
+// Загрузка LANES блоков в плоскости
+template <typename W>
+inline void bsLoad(const uint16_t* in, W s[16]) {
+    for (int c = 0; c < BsTraits<W>::WORDS; ++c) {
+        const uint16_t* src = in + c * 64;
+        uint64_t w[16];
+        for (int r = 0; r < 16; ++r)
+            w[r] = (uint64_t)src[r] | ((uint64_t)src[r + 16] << 16) |
+                   ((uint64_t)src[r + 32] << 32) | ((uint64_t)src[r + 48] << 48);
+        bsTranspose16x4(w);
+        for (int p = 0; p < 16; ++p) bsSetWord(s[p], c, w[p]);
+    }
+}
+
+// Выгрузка плоскостей обратно в LANES блоков
+template <typename W>
+inline void bsStore(const W s[16], uint16_t* out) {
+    for (int c = 0; c < BsTraits<W>::WORDS; ++c) {
+        uint64_t w[16];
+        for (int p = 0; p < 16; ++p) w[p] = bsGetWord(s[p], c);
+        bsTranspose16x4(w);
+        uint16_t* dst = out + c * 64;
+        for (int r = 0; r < 16; ++r) {
+            dst[r]      = (uint16_t)w[r];
+            dst[r + 16] = (uint16_t)(w[r] >> 16);
+            dst[r + 32] = (uint16_t)(w[r] >> 32);
+            dst[r + 48] = (uint16_t)(w[r] >> 48);
+        }
+    }
+}
+
+// --- ПАКЕТНЫЙ API ---
+//
+// Шифр задается CipherSpec (по умолчанию activeCipher(), то есть с учетом
+// --cipher/--master); rounds < 0 — spec.rounds.
+
+// Шифрование ровно BsTraits<W>::LANES упакованных блоков (in и out могут совпадать)
+template <typename W>
+inline void encryptBatch(const uint16_t* in, uint16_t* out, const CipherSpec& spec = activeCipher(),
+                         int rounds = -1) {
+    W s[16];
+    bsLoad(in, s);
+    bsEncryptRounds(s, spec, rounds < 0 ? spec.rounds : rounds);
+    bsStore(s, out);
+}
+
+// Шифрование произвольного количества блоков на родной ширине.
+// Хвост дополняется нулями во временном буфере.
+inline void encryptBlocks(const uint16_t* in, uint16_t* out, size_t n, const CipherSpec& spec = activeCipher(),
+                          int rounds = -1) {
+    const size_t L = BsTraits<bs_native_t>::LANES;
+    size_t i = 0;
+    for (; i + L <= n; i += L) encryptBatch<bs_native_t>(in + i, out + i, spec, rounds);
+    if (i < n) {
+        uint16_t buf[L] = {0};
+        for (size_t j = i; j < n; ++j) buf[j - i] = in[j];
+        encryptBatch<bs_native_t>(buf, buf, spec, rounds);
+        for (size_t j = i; j < n; ++j) out[j] = buf[j - i];
+    }
+}
+
+// Проверка побитового совпадения с CipherSpec::encrypt() на всех 2^16
+// блоках. Возвращает false при первом расхождении.
+template <typename W>
+inline bool bitsliceCheckWidth(const CipherSpec& spec, int rounds) {
+    const int L = BsTraits<W>::LANES;
+    uint16_t in[L], out[L];
+    for (uint32_t base = 0; base < 65536; base += L) {
+        for (int i = 0; i < L; ++i) in[i] = (uint16_t)(base + i);
+        encryptBatch<W>(in, out, spec, rounds);
+        for (int i = 0; i < L; ++i)
+            if (spec.encrypt(in[i], rounds) != out[i]) return false;
+    }
+    return true;
+}
+
+// Все ширины пакета и все числа раундов 1..spec.rounds
+inline bool bitsliceSelfCheck(const CipherSpec& spec = activeCipher()) {
+    for (int r = 1; r <= spec.rounds; ++r) {
+        if (!bitsliceCheckWidth<bs64_t>(spec, r)) return false;
+        if (!bitsliceCheckWidth<bs256_t>(spec, r)) return false;
+        if (!bitsliceCheckWidth<bs512_t>(spec, r)) return false;
+    }
+    return true;
+}
+
+#endif // BITSLICE_H
@@ -12,7 +12,7 @@
 const int NUM_ROUNDS = 6;
 
 // S-Box (G): {13, 6, 0, 10, 15, 7, 14, 11, 9, 1, 5, 3, 4, 12, 8, 2}
-const uint8_t SBOX[16] = {
+constexpr uint8_t SBOX[16] = {
     13, 6, 0, 10, 15, 7, 14, 11, 9, 1, 5, 3, 4, 12, 8, 2
 };
 
@@ -22,6 +22,9 @@ const uint8_t ROUND_KEYS[6] = {
     0x1, 0x3, 0x5, 0x7, 0x1, 0x3
 };
 
+// Мастер-ключ: 4 ниббла t1..t4, упакованы как 0x(t1)(t2)(t3)(t4)
+const int MASTER_KEY_NIBBLES = 4;
+
 // --- СТРУКТУРЫ ДАННЫХ ---
 
 // Блок данных: 4 ниббла (по 4 бита)
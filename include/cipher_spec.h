@@ -0,0 +1,244 @@
+#ifndef CIPHER_SPEC_H
+#define CIPHER_SPEC_H
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include "cipher_engine.h"
+
+// --- ПАРАМЕТРЫ ШИФРА ВО ВРЕМЯ ВЫПОЛНЕНИЯ ---
+//
+// CipherSpec — S-Box, раундовые ключи и число раундов одного экземпляра
+// шифра. По умолчанию совпадает с константами Варианта 5 (SBOX,
+// ROUND_KEYS, NUM_ROUNDS); другой вариант задается файлом или ключами
+// командной строки без перекомпиляции:
+//   --cipher=FILE   файл параметров (формат ниже)
+//   --master=HEX    мастер-ключ t1..t4, например --master=1357
+//
+// Формат файла (строки "имя значения...", # — комментарий):
+//   sbox   13 6 0 10 15 7 14 11 9 1 5 3 4 12 8 2
+//   rounds 6
+//   master 1357          # k_r = t_{((r-1) mod 4) + 1}
+//   keys   1 3 5 7 1 3   # либо раундовые ключи явно, не меньше rounds
+//
+// Шифрование по спецификации раскрыто шаблоном по числу раундов
+// (encryptSpecRounds<R>) для R = 1..MAX_UNROLLED_ROUNDS; горячие циклы
+// инструментов при этом идут через кодбук (codebook.h) и от спецификации
+// не зависят.
+
+const int MAX_ROUNDS = 16;
+const int MAX_UNROLLED_ROUNDS = 8;
+
+struct CipherSpec {
+    uint8_t sbox[16];
+    uint8_t roundKeys[MAX_ROUNDS];
+    int rounds;
+
+    CipherSpec() : rounds(NUM_ROUNDS) {
+        memcpy(sbox, SBOX, 16);
+        memset(roundKeys, 0, sizeof(roundKeys));
+        memcpy(roundKeys, ROUND_KEYS, NUM_ROUNDS);
+    }
+
+    uint8_t G(uint8_t v) const { return sbox[v & 0xF]; }
+
+    uint8_t F(uint8_t x2, uint8_t x3, uint8_t k) const { return G(x2 ^ G(k ^ x3)); }
+
+    // Раундовые ключи из мастер-ключа 0x(t1)(t2)(t3)(t4)
+    void setMaster(uint16_t master) {
+        for (int r = 0; r < MAX_ROUNDS; ++r)
+            roundKeys[r] = (master >> (12 - 4 * (r % MASTER_KEY_NIBBLES))) & 0xF;
+    }
+
+    bool isPermutation() const {
+        int seen = 0;
+        for (int i = 0; i < 16; ++i) seen |= 1 << (sbox[i] & 0xF);
+        return seen == 0xFFFF;
+    }
+
+    bool isDefault() const {
+        return rounds == NUM_ROUNDS && memcmp(sbox, SBOX, 16) == 0 &&
+               memcmp(roundKeys, ROUND_KEYS, NUM_ROUNDS) == 0;
+    }
+
+    // FNV-1a 64 по S-Box, ключам и числу раундов (как cipherScheduleHash
+    // до появления CipherSpec: для Варианта 5 значение то же)
+    uint64_t hash() const {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        auto mix = [&h](uint8_t v) { h ^= v; h *= 0x100000001b3ULL; };
+        for (int i = 0; i < 16; ++i) mix(sbox[i]);
+        for (int i = 0; i < rounds; ++i) mix(roundKeys[i]);
+        mix((uint8_t)rounds);
+        return h;
+    }
+
+    // Один раунд над упакованным блоком: (x0,x1,x2,x3) -> (x1,x2,x3,x0^F)
+    uint16_t round(uint16_t s, uint8_t k) const {
+        uint8_t f = F((s >> 4) & 0xF, s & 0xF, k);
+        return (uint16_t)((s << 4) | ((s >> 12) ^ f));
+    }
+
+    // Откат одного раунда (как decryptOneRound)
+    uint16_t unround(uint16_t s, uint8_t k) const {
+        uint8_t x0 = (s & 0xF) ^ F((s >> 8) & 0xF, (s >> 4) & 0xF, k);
+        return (uint16_t)((x0 << 12) | (s >> 4));
+    }
+
+    uint16_t encrypt(uint16_t x, int r) const;
+    uint16_t encrypt(uint16_t x) const { return encrypt(x, rounds); }
+};
+
+template <int R>
+inline uint16_t encryptSpecRounds(const CipherSpec& c, uint16_t x) {
+    for (int r = 0; r < R; ++r) x = c.round(x, c.roundKeys[r]);
+    return x;
+}
+
+inline uint16_t CipherSpec::encrypt(uint16_t x, int r) const {
+    switch (r) {
+        case 1: return encryptSpecRounds<1>(*this, x);
+        case 2: return encryptSpecRounds<2>(*this, x);
+        case 3: return encryptSpecRounds<3>(*this, x);
+        case 4: return encryptSpecRounds<4>(*this, x);
+        case 5: return encryptSpecRounds<5>(*this, x);
+        case 6: return encryptSpecRounds<6>(*this, x);
+        case 7: return encryptSpecRounds<7>(*this, x);
+        case 8: return encryptSpecRounds<8>(*this, x);
+        default:
+            for (int i = 0; i < r && i < MAX_ROUNDS; ++i) x = round(x, roundKeys[i]);
+            return x;
+    }
+}
+
+// Экземпляр шифра процесса: его шифрует кодбук и проверяют заголовки файлов
+inline CipherSpec& activeCipher() {
+    static CipherSpec spec;
+    return spec;
+}
+
+inline uint64_t cipherScheduleHash() { return activeCipher().hash(); }
+
+// Мастер-ключ: 1..4 шестнадцатеричные цифры, целиком (без знака и хвоста)
+inline bool parseMasterHex(const std::string& text, uint16_t& master) {
+    if (text.empty() || !isxdigit((unsigned char)text[0])) return false;
+    char* end = nullptr;
+    unsigned long v = strtoul(text.c_str(), &end, 16);
+    if (*end != '\0' || v > 0xFFFF) return false;
+    master = (uint16_t)v;
+    return true;
+}
+
+inline bool loadCipherSpec(const std::string& path, CipherSpec& spec) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Error: cannot open cipher spec " << path << "\n";
+        return false;
+    }
+    bool haveKeys = false;
+    int keyCount = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        std::string name;
+        if (!(ss >> name)) continue;
+        if (name == "sbox") {
+            for (int i = 0; i < 16; ++i) {
+                int v;
+                if (!(ss >> v) || v < 0 || v > 15) {
+                    std::cerr << "Error: " << path << ": sbox needs 16 values 0..15\n";
+                    return false;
+                }
+                spec.sbox[i] = (uint8_t)v;
+            }
+        } else if (name == "rounds") {
+            if (!(ss >> spec.rounds) || spec.rounds < 1 || spec.rounds > MAX_ROUNDS) {
+                std::cerr << "Error: " << path << ": rounds must be in 1.." << MAX_ROUNDS << "\n";
+                return false;
+            }
+        } else if (name == "master") {
+            std::string hex, extra;
+            uint16_t master;
+            if (!(ss >> hex) || ss >> extra || !parseMasterHex(hex, master)) {
+                std::cerr << "Error: " << path << ": master needs one hex value 0..ffff\n";
+                return false;
+            }
+            if (!haveKeys) spec.setMaster(master);
+        } else if (name == "keys") {
+            // Число ключей сверяется с rounds после файла: rounds может идти ниже
+            std::string tok;
+            keyCount = 0;
+            while (ss >> tok) {
+                char* end = nullptr;
+                long v = strtol(tok.c_str(), &end, 10);
+                if (*end != '\0' || v < 0 || v > 15 || keyCount == MAX_ROUNDS) {
+                    std::cerr << "Error: " << path << ": keys needs values 0..15, at most " << MAX_ROUNDS << "\n";
+                    return false;
+                }
+                spec.roundKeys[keyCount++] = (uint8_t)v;
+            }
+            haveKeys = true;
+        } else {
+            std::cerr << "Error: " << path << ": unknown field '" << name << "'\n";
+            return false;
+        }
+    }
+    if (haveKeys && keyCount < spec.rounds) {
+        std::cerr << "Error: " << path << ": keys needs " << spec.rounds << " values 0..15 (one per round), got "
+                  << keyCount << "\n";
+        return false;
+    }
+    if (!spec.isPermutation()) {
+        std::cerr << "Error: " << path << ": sbox is not a permutation\n";
+        return false;
+    }
+    return true;
+}
+
+// Разбирает --cipher=FILE и --master=HEX, устанавливает activeCipher()
+// и убирает эти аргументы из argv, остальные остаются инструменту.
+inline bool parseCipherArgs(int& argc, char** argv) {
+    CipherSpec& spec = activeCipher();
+    int out = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--cipher=", 0) == 0) {
+            if (!loadCipherSpec(arg.substr(9), spec)) return false;
+        } else if (arg.rfind("--master=", 0) == 0) {
+            uint16_t master;
+            if (!parseMasterHex(arg.substr(9), master)) {
+                std::cerr << "Error: --master needs a hex value 0..ffff, got '" << arg.substr(9) << "'\n";
+                return false;
+            }
+            spec.setMaster(master);
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argc = out;
+    if (!spec.isDefault()) {
+        std::cout << "Cipher: rounds=" << spec.rounds << " keys=";
+        for (int r = 0; r < spec.rounds; ++r) std::cout << std::hex << (int)spec.roundKeys[r];
+        std::cout << std::dec << " sbox=";
+        for (int i = 0; i < 16; ++i) std::cout << (i ? "," : "") << (int)spec.sbox[i];
+        std::cout << "\n";
+    }
+    return true;
+}
+
+// Для инструментов без собственных аргументов
+inline bool parseCipherArgsOnly(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return false;
+    if (argc > 1) {
+        std::cerr << "Usage: " << argv[0] << " [--cipher=FILE] [--master=HEX]\n";
+        return false;
+    }
+    return true;
+}
+
+#endif // CIPHER_SPEC_H
@@ -0,0 +1,221 @@
+#ifndef CODEBOOK_H
+#define CODEBOOK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "bitslice.h"
+#include "thread_pool.h"
+#include "instrument.h"
+
+// --- ПОЛНЫЙ КОДБУК (2^16 БЛОКОВ) ---
+//
+// Шифр на 16-битном блоке — перестановка из 65536 элементов, поэтому
+// E_r(x) для каждого числа раундов r = 1..R и обратные к ним
+// таблицы занимают всего 2 * R * 128 KiB.
+// Таблицы строятся один раз для экземпляра шифра (CipherSpec, по умолчанию
+// activeCipher(); битслайсом, в потоках) и сохраняются в codebook.bin;
+// инструменты отображают файл через mmap. build() без файла — для
+// перебора многих ключей в одном процессе.
+//
+// Формат файла (little-endian):
+//   CodebookHeader
+//   enc[1..R][65536] uint16   — E_r(x)
+//   dec[1..R][65536] uint16   — E_r^{-1}(y)
+
+const char CODEBOOK_MAGIC[8] = {'G', 'F', 'N', 'C', 'B', 'O', 'O', 'K'};
+const uint32_t CODEBOOK_VERSION = 1;
+const size_t CODEBOOK_ENTRIES = 65536;
+// Пакетов битслайса на кусок пула при построении таблиц
+const size_t CODEBOOK_BUILD_GRAIN = 16;
+
+struct CodebookHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t rounds;
+    uint64_t scheduleHash;
+};
+
+class Codebook {
+public:
+    Codebook() = default;
+    Codebook(const Codebook&) = delete;
+    Codebook& operator=(const Codebook&) = delete;
+    ~Codebook() { release(); }
+
+    // Отображает файл, если он совпадает по версии и хэшу расписания,
+    // иначе строит таблицы и перезаписывает файл.
+    bool open(const std::string& path = "codebook.bin", const CipherSpec& spec = activeCipher()) {
+        release();
+        spec_ = spec;
+        PROFILE_SCOPE("codebook");
+        if (mapFile(path)) return true;
+
+        std::cout << "Building codebook (" << spec_.rounds << " rounds)..." << std::endl;
+        if (!buildTables()) return false;
+        if (!save(path))
+            std::cerr << "Warning: cannot write " << path << ", using in-memory codebook.\n";
+        return true;
+    }
+
+    // Таблицы только в памяти
+    bool build(const CipherSpec& spec) {
+        release();
+        spec_ = spec;
+        return buildTables();
+    }
+
+    const CipherSpec& spec() const { return spec_; }
+    int rounds() const { return spec_.rounds; }
+
+    // E_r(x), r = 1..rounds() (0 — все раунды)
+    uint16_t enc(uint16_t x, int rounds = 0) const {
+        return encTable(rounds)[x];
+    }
+
+    // E_r^{-1}(y)
+    uint16_t dec(uint16_t y, int rounds = 0) const {
+        return decTable(rounds)[y];
+    }
+
+    const uint16_t* encTable(int rounds = 0) const {
+        if (rounds == 0) rounds = spec_.rounds;
+        return tables_ + (size_t)(rounds - 1) * CODEBOOK_ENTRIES;
+    }
+
+    const uint16_t* decTable(int rounds = 0) const {
+        if (rounds == 0) rounds = spec_.rounds;
+        return tables_ + (size_t)(spec_.rounds + rounds - 1) * CODEBOOK_ENTRIES;
+    }
+
+private:
+    size_t tableBytes() const { return 2 * (size_t)spec_.rounds * CODEBOOK_ENTRIES * sizeof(uint16_t); }
+
+    bool mapFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        size_t expected = sizeof(CodebookHeader) + tableBytes();
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size != expected) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, expected, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+
+        CodebookHeader h;
+        memcpy(&h, p, sizeof(h));
+        if (memcmp(h.magic, CODEBOOK_MAGIC, 8) != 0 || h.version != CODEBOOK_VERSION ||
+            h.rounds != (uint32_t)spec_.rounds || h.scheduleHash != spec_.hash()) {
+            munmap(p, expected);
+            return false;
+        }
+        PROFILE_COUNT("bytes mapped", expected);
+        map_ = p;
+        mapSize_ = expected;
+        tables_ = (const uint16_t*)((const char*)p + sizeof(CodebookHeader));
+        return true;
+    }
+
+    bool buildTables() {
+        const int R = spec_.rounds;
+        heap_.assign(2 * (size_t)R * CODEBOOK_ENTRIES, 0);
+        PROFILE_COUNT("alloc bytes", heap_.size() * sizeof(uint16_t));
+        uint16_t* t = heap_.data();
+
+        typedef bs_native_t W;
+        const int L = BsTraits<W>::LANES;
+        const int chunks = (int)(CODEBOOK_ENTRIES / L);
+
+        // S-Box Варианта 5 — константная схема (SBOX_ANF сворачивается),
+        // иначе ANF считается для спецификации
+        const bool constSbox = memcmp(spec_.sbox, SBOX, 16) == 0;
+        const SboxAnf anf = computeSboxAnf(spec_.sbox);
+
+        // 1. Прямые таблицы: пакеты x раздаются в общем пуле, после каждого
+        //    раунда снимается состояние.
+        parallelFor(0, chunks, CODEBOOK_BUILD_GRAIN, [&](size_t b, size_t e, unsigned) {
+            uint16_t in[L];
+            for (int c = (int)b; c < (int)e; ++c) {
+                for (int i = 0; i < L; ++i) in[i] = (uint16_t)(c * L + i);
+                W s[16];
+                bsLoad(in, s);
+                for (int r = 0; r < R; ++r) {
+                    if (constSbox) bsRound(s, spec_.roundKeys[r]);
+                    else bsRound(s, spec_.roundKeys[r], anf);
+                    bsStore(s, t + (size_t)r * CODEBOOK_ENTRIES + (size_t)c * L);
+                }
+            }
+        });
+        // 2. Обратные таблицы: dec[r][enc[r][x]] = x (адреса не пересекаются)
+        parallelFor(0, (size_t)R * CODEBOOK_ENTRIES, CODEBOOK_ENTRIES / 4, [&](size_t b, size_t e, unsigned) {
+            for (size_t i = b; i < e; ++i) {
+                size_t r = i / CODEBOOK_ENTRIES, x = i % CODEBOOK_ENTRIES;
+                t[(R + r) * CODEBOOK_ENTRIES + t[i]] = (uint16_t)x;
+            }
+        });
+
+        // Сверка битслайса со скалярным CipherSpec::encrypt на всех блоках
+        for (size_t x = 0; x < CODEBOOK_ENTRIES; ++x) {
+            if (t[(size_t)(R - 1) * CODEBOOK_ENTRIES + x] != spec_.encrypt((uint16_t)x)) {
+                std::cerr << "Error: bitsliced engine does not match CipherSpec::encrypt().\n";
+                heap_.clear();
+                return false;
+            }
+        }
+
+        tables_ = t;
+        return true;
+    }
+
+    // Запись через временный файл, чтобы параллельный запуск не увидел половину.
+    // Имя временного файла — с pid: одновременные построения не пишут в один файл,
+    // rename в том же каталоге атомарен, последний просто заменяет предыдущий.
+    bool save(const std::string& path) const {
+        std::string tmp = path + ".tmp." + std::to_string((long)getpid());
+        FILE* f = fopen(tmp.c_str(), "wb");
+        if (!f) return false;
+
+        CodebookHeader h;
+        memcpy(h.magic, CODEBOOK_MAGIC, 8);
+        h.version = CODEBOOK_VERSION;
+        h.rounds = spec_.rounds;
+        h.scheduleHash = spec_.hash();
+
+        bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  fwrite(tables_, 1, tableBytes(), f) == tableBytes();
+        ok = (fclose(f) == 0) && ok;
+        if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+            remove(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void release() {
+        if (map_) munmap(map_, mapSize_);
+        map_ = nullptr;
+        mapSize_ = 0;
+        heap_.clear();
+        tables_ = nullptr;
+    }
+
+    void* map_ = nullptr;
+    size_t mapSize_ = 0;
+    std::vector<uint16_t> heap_;
+    const uint16_t* tables_ = nullptr;
+    CipherSpec spec_;
+};
+
+#endif // CODEBOOK_H
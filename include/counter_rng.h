@@ -0,0 +1,64 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <cstdint>
+#include <cstddef>
+
+// --- СЧЕТЧИКОВЫЙ ГЕНЕРАТОР (SplitMix64 по индексу) ---
+//
+// Значение — чистая функция от (seed, stream, index): слово с номером w
+// равно финализатору SplitMix64 от key + w * GOLDEN, где key выводится
+// из seed и номера потока данных. Состояния нет, поэтому любой поток
+// может взять любой срез индексов, и набор данных не зависит от числа
+// потоков и размера порций. Цикл fill16 без зависимостей между
+// итерациями и векторизуется компилятором.
+//
+// Одно 64-битное слово дает 4 блока по 16 бит: блок i — поле i & 3
+// слова i >> 2.
+
+const uint64_t DEFAULT_DATA_SEED = 12345;
+
+// Потоки данных: разные инструменты с одним seed не делят выборку
+enum RngStream : uint64_t {
+    RNG_STREAM_DIFF_PAIRS = 1, // открытые тексты X пар (generator, pipeline, attack_multi, key_sweep)
+    RNG_STREAM_STRUCTURES = 2, // порядок баз структур
+    RNG_STREAM_LINEAR = 3,     // известные открытые тексты линейной атаки
+    RNG_STREAM_KEYS = 4        // случайные ключи key_sweep
+};
+
+inline uint64_t splitmix64Mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+struct CounterRng {
+    static constexpr uint64_t GOLDEN = 0x9e3779b97f4a7c15ULL;
+    uint64_t key;
+
+    // sub — номер подпотока (например, индекс ключа в key_sweep)
+    CounterRng(uint64_t seed, uint64_t stream, uint64_t sub = 0)
+        : key(splitmix64Mix(splitmix64Mix(seed ^ (stream * 0xd1b54a32d192ed03ULL)) + sub * GOLDEN)) {}
+
+    uint64_t word(uint64_t w) const { return splitmix64Mix(key + (w + 1) * GOLDEN); }
+
+    uint16_t block(uint64_t i) const { return (uint16_t)(word(i >> 2) >> (16 * (i & 3))); }
+
+    // out[j] = block(first + j), j < n
+    void fill16(uint64_t first, size_t n, uint16_t* out) const {
+        size_t j = 0;
+        for (; j < n && ((first + j) & 3); ++j) out[j] = block(first + j);
+        uint64_t w0 = (first + j) >> 2;
+        size_t words = (n - j) / 4;
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t v = word(w0 + w);
+            out[j + 4 * w] = (uint16_t)v;
+            out[j + 4 * w + 1] = (uint16_t)(v >> 16);
+            out[j + 4 * w + 2] = (uint16_t)(v >> 32);
+            out[j + 4 * w + 3] = (uint16_t)(v >> 48);
+        }
+        for (j += 4 * words; j < n; ++j) out[j] = block(first + j);
+    }
+};
+
+#endif // COUNTER_RNG_H
@@ -0,0 +1,120 @@
+#ifndef DDT_TABLE_H
+#define DDT_TABLE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+
+// --- ТАБЛИЦЫ РАЗНОСТЕЙ S-БЛОКА И ФУНКЦИИ F (ddt_table.bin) ---
+//
+// F(x2, x3, k) = G(x2 ^ G(k ^ x3)): при независимом ключе переход
+// (dx2, dx3) -> dF идет через промежуточную разность d_mid:
+//   N_F[(dx2,dx3)][dF] = sum_mid DDT[dx3][d_mid] * DDT[dx2 ^ d_mid][dF],
+// вероятность — N_F / 256. Таблица строится один раз (ddt_gen) вместо
+// пересчета 16 слагаемых на каждый запрос.
+//
+// Формат файла (little-endian):
+//   int32  ddt[16][16]        — DDT S-блока (число пар из 16), как раньше
+//   DdtFileHeader
+//   uint16 fCount[256][16]    — N_F, индекс строки (dx2 << 4) | dx3
+// Разреженные списки ненулевых переходов строятся при загрузке.
+
+const char DDT_MAGIC[8] = {'G', 'F', 'N', 'F', 'D', 'D', 'T', '0'};
+const uint32_t DDT_VERSION = 1;
+
+struct DdtFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+// Ненулевой переход F: выходная разность и ее вероятность
+struct FTransition {
+    double prob;
+    uint8_t dF;
+};
+
+struct DdtTables {
+    int sbox[16][16];            // DDT S-блока, счетчики
+    uint16_t fCount[256][16];    // DDT функции F, счетчики из 256
+    double sboxProb[16][16];
+    double fProb[256][16];
+    // Ненулевые переходы F для строки (dx2, dx3), по убыванию вероятности
+    FTransition fList[256][16];
+    uint8_t fNum[256];
+};
+
+inline void buildSboxDdt(int ddt[16][16], const CipherSpec& c = activeCipher()) {
+    memset(ddt, 0, sizeof(int) * 16 * 16);
+    for (int d_in = 0; d_in < 16; ++d_in)
+        for (int x = 0; x < 16; ++x)
+            ddt[d_in][c.G(x) ^ c.G(x ^ d_in)]++;
+}
+
+inline void buildFDdt(const int ddt[16][16], uint16_t fCount[256][16]) {
+    for (int v = 0; v < 256; ++v) {
+        int dx2 = v >> 4, dx3 = v & 0xF;
+        for (int dF = 0; dF < 16; ++dF) {
+            int n = 0;
+            for (int d_mid = 0; d_mid < 16; ++d_mid)
+                n += ddt[dx3][d_mid] * ddt[dx2 ^ d_mid][dF];
+            fCount[v][dF] = (uint16_t)n;
+        }
+    }
+}
+
+// Вероятности и разреженные списки по счетчикам
+inline void finishDdtTables(DdtTables& t) {
+    for (int i = 0; i < 16; ++i)
+        for (int j = 0; j < 16; ++j)
+            t.sboxProb[i][j] = t.sbox[i][j] / 16.0;
+    for (int v = 0; v < 256; ++v) {
+        int n = 0;
+        for (int dF = 0; dF < 16; ++dF) {
+            t.fProb[v][dF] = t.fCount[v][dF] / 256.0;
+            if (t.fCount[v][dF]) t.fList[v][n++] = FTransition{t.fProb[v][dF], (uint8_t)dF};
+        }
+        std::stable_sort(t.fList[v], t.fList[v] + n,
+                         [](const FTransition& a, const FTransition& b) { return a.prob > b.prob; });
+        t.fNum[v] = (uint8_t)n;
+    }
+}
+
+inline void buildDdtTables(DdtTables& t, const CipherSpec& c = activeCipher()) {
+    buildSboxDdt(t.sbox, c);
+    buildFDdt(t.sbox, t.fCount);
+    finishDdtTables(t);
+}
+
+inline bool writeDdtFile(const std::string& path, const DdtTables& t) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    DdtFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DDT_MAGIC, 8);
+    h.version = DDT_VERSION;
+    bool ok = fwrite(t.sbox, sizeof(int), 16 * 16, f) == 16 * 16 &&
+              fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(t.fCount, sizeof(uint16_t), 256 * 16, f) == 256 * 16;
+    return (fclose(f) == 0) && ok;
+}
+
+// false, если файла нет или он старого формата (только DDT S-блока)
+inline bool readDdtFile(const std::string& path, DdtTables& t) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    DdtFileHeader h;
+    bool ok = fread(t.sbox, sizeof(int), 16 * 16, f) == 16 * 16 &&
+              fread(&h, sizeof(h), 1, f) == 1 &&
+              memcmp(h.magic, DDT_MAGIC, 8) == 0 && h.version == DDT_VERSION &&
+              fread(t.fCount, sizeof(uint16_t), 256 * 16, f) == 256 * 16;
+    fclose(f);
+    if (ok) finishDdtTables(t);
+    return ok;
+}
+
+#endif // DDT_TABLE_H
@@ -0,0 +1,116 @@
+#ifndef EXACT_DDT_H
+#define EXACT_DDT_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "cipher_engine.h"
+#include "thread_pool.h"
+#include "progress.h"
+
+// --- ТОЧНАЯ DDT ШИФРА (без выборки) ---
+//
+// Для перестановки E на 2^16 элементах строка DDT для входной разности dX
+// row[dY] = #{x : E(x) ^ E(x ^ dX) = dY}
+// считается за 2^15 шагов: пары (x, x^dX) перебираются один раз
+// (x без старшего бита dX), каждая дает +2.
+// Строки хранятся в плоских массивах uint32 по 65536 элементов.
+
+const int DDT_SIZE = 65536;
+
+// Тайлы: DX_TILE строк обрабатываются за один проход по X_TILE значениям x,
+// так что кусок таблицы E остается в L1, а строки — в L2.
+const int DDT_DX_TILE = 4;
+const int DDT_X_TILE = 2048;
+
+struct DiffEntry {
+    uint32_t count;
+    uint16_t dX;
+    uint16_t dY;
+};
+
+// Порядок рейтинга: count по убыванию, затем (dX, dY) по возрастанию
+inline bool diffEntryBetter(const DiffEntry& a, const DiffEntry& b) {
+    if (a.count != b.count) return a.count > b.count;
+    if (a.dX != b.dX) return a.dX < b.dX;
+    return a.dY < b.dY;
+}
+
+// Точные строки для n разностей dX[0..n-1] (n <= DDT_DX_TILE).
+// rows[i] — массив из DDT_SIZE счетчиков, обнуляется здесь.
+inline void exactDdtRows(const uint16_t* E, const uint16_t* dX, int n, uint32_t* const* rows) {
+    for (int i = 0; i < n; ++i) memset(rows[i], 0, DDT_SIZE * sizeof(uint32_t));
+
+    for (int base = 0; base < DDT_SIZE; base += DDT_X_TILE) {
+        for (int i = 0; i < n; ++i) {
+            uint16_t d = dX[i];
+            if (d == 0) {
+                if (base == 0) rows[i][0] = DDT_SIZE;
+                continue;
+            }
+            uint32_t hb = 1u << (31 - __builtin_clz((uint32_t)d));
+            uint32_t* row = rows[i];
+            for (int x = base; x < base + DDT_X_TILE; ++x) {
+                if (x & hb) continue;
+                row[E[x] ^ E[x ^ d]] += 2;
+            }
+        }
+    }
+}
+
+inline void exactDdtRow(const uint16_t* E, uint16_t dX, uint32_t* row) {
+    exactDdtRows(E, &dX, 1, &row);
+}
+
+// Top-K по всем строкам для списка dX. Тайлы dX раздаются в общем пуле
+// (thread_pool.h), у каждого исполнителя свой буфер строк и своя куча
+// кандидатов; в конце кучи сливаются. progress считает строки dX.
+// dY = 0 (для dX = 0) в рейтинг не попадает.
+inline std::vector<DiffEntry> exactDdtTopK(const uint16_t* E, const std::vector<uint16_t>& dXs,
+                                           size_t K, ProgressMeter* progress = nullptr) {
+    std::vector<std::vector<DiffEntry>> heaps(poolThreads());
+    std::vector<std::vector<uint32_t>> bufs(poolThreads());
+    auto worse = [](const DiffEntry& a, const DiffEntry& b) { return diffEntryBetter(a, b); };
+
+    parallelFor(0, dXs.size(), DDT_DX_TILE, [&](size_t b, size_t e, unsigned tid) {
+        std::vector<uint32_t>& buf = bufs[tid];
+        if (buf.empty()) buf.resize((size_t)DDT_DX_TILE * DDT_SIZE);
+        uint32_t* rows[DDT_DX_TILE];
+        for (int i = 0; i < DDT_DX_TILE; ++i) rows[i] = buf.data() + (size_t)i * DDT_SIZE;
+        std::vector<DiffEntry>& heap = heaps[tid];
+
+        for (size_t start = b; start < e; start += DDT_DX_TILE) {
+            int n = (int)std::min<size_t>(DDT_DX_TILE, e - start);
+            exactDdtRows(E, &dXs[start], n, rows);
+
+            for (int i = 0; i < n; ++i) {
+                const uint32_t* row = rows[i];
+                for (int dY = 1; dY < DDT_SIZE; ++dY) {
+                    uint32_t c = row[dY];
+                    if (c == 0) continue;
+                    if (heap.size() == K && c < heap.front().count) continue;
+                    DiffEntry entry{c, dXs[start + i], (uint16_t)dY};
+                    if (heap.size() < K) {
+                        heap.push_back(entry);
+                        std::push_heap(heap.begin(), heap.end(), worse);
+                    } else if (diffEntryBetter(entry, heap.front())) {
+                        std::pop_heap(heap.begin(), heap.end(), worse);
+                        heap.back() = entry;
+                        std::push_heap(heap.begin(), heap.end(), worse);
+                    }
+                }
+            }
+        }
+        if (progress) progress->add(e - b);
+    });
+
+    std::vector<DiffEntry> all;
+    for (auto& h : heaps) all.insert(all.end(), h.begin(), h.end());
+    size_t k = std::min(K, all.size());
+    std::partial_sort(all.begin(), all.begin() + k, all.end(), diffEntryBetter);
+    all.resize(k);
+    return all;
+}
+
+#endif // EXACT_DDT_H
@@ -0,0 +1,90 @@
+#ifndef FLAT_HASH_H
+#define FLAT_HASH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+// --- ПЛОСКАЯ ХЭШ-ТАБЛИЦА (открытая адресация) ---
+//
+// Ключи uint64_t (значение ~0 зарезервировано как "пусто"), линейное
+// пробирование, емкость — степень двойки, рост при заполнении > 1/2.
+// Замена std::map для счетчиков в горячих циклах: никаких узлов и
+// аллокаций на вставку, данные лежат подряд.
+
+template <typename V>
+class FlatHashMap {
+public:
+    static constexpr uint64_t EMPTY = ~0ULL;
+
+    explicit FlatHashMap(size_t capacity = 1024) { init(capacity); }
+
+    V& operator[](uint64_t key) {
+        if ((size_ + 1) * 2 > keys_.size()) grow();
+        size_t i = slot(key);
+        while (keys_[i] != EMPTY) {
+            if (keys_[i] == key) return values_[i];
+            i = (i + 1) & mask_;
+        }
+        keys_[i] = key;
+        values_[i] = V();
+        ++size_;
+        return values_[i];
+    }
+
+    const V* find(uint64_t key) const {
+        size_t i = slot(key);
+        while (keys_[i] != EMPTY) {
+            if (keys_[i] == key) return &values_[i];
+            i = (i + 1) & mask_;
+        }
+        return nullptr;
+    }
+
+    // f(key, value) для всех элементов
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t i = 0; i < keys_.size(); ++i)
+            if (keys_[i] != EMPTY) f(keys_[i], values_[i]);
+    }
+
+    size_t size() const { return size_; }
+
+    void clear() {
+        std::fill(keys_.begin(), keys_.end(), EMPTY);
+        size_ = 0;
+    }
+
+private:
+    void init(size_t capacity) {
+        size_t cap = 16;
+        while (cap < capacity) cap <<= 1;
+        keys_.assign(cap, EMPTY);
+        values_.assign(cap, V());
+        mask_ = cap - 1;
+        size_ = 0;
+    }
+
+    size_t slot(uint64_t key) const {
+        // Фибоначчиево хэширование: старшие биты произведения
+        return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask_;
+    }
+
+    void grow() {
+        std::vector<uint64_t> oldKeys;
+        std::vector<V> oldValues;
+        oldKeys.swap(keys_);
+        oldValues.swap(values_);
+        init(oldKeys.size() * 2);
+        for (size_t i = 0; i < oldKeys.size(); ++i)
+            if (oldKeys[i] != EMPTY) (*this)[oldKeys[i]] = oldValues[i];
+    }
+
+    std::vector<uint64_t> keys_;
+    std::vector<V> values_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+};
+
+#endif // FLAT_HASH_H
@@ -0,0 +1,184 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+// --- ИНСТРУМЕНТИРОВАНИЕ: ЭТАПЫ, СЧЕТЧИКИ, CHROME TRACE ---
+//
+// Включается сборкой с -DGFN_PROFILE (make PROFILE=1); без флага все
+// макросы ниже раскрываются в пустоту и в коде не остается ни вызовов,
+// ни данных.
+//
+//   PROFILE_SCOPE("merge");                 // этап до конца блока
+//   PROFILE_STAGE(load, "load");            // этап с явным концом:
+//   PROFILE_STAGE_END(load, n);             //   n — единиц работы (пар...)
+//   PROFILE_COUNT("bytes mapped", size);    // именованный счетчик
+//   PROFILE_COUNT("bytes read", profileFileSize(path));
+//
+// Этапы одного имени суммируются (вызовы, время, единицы). При выходе из
+// процесса в stderr печатается сводка: время этапа, доля от времени
+// процесса, единиц/с, затем счетчики. Куски пула (thread_pool.h) идут
+// этапом "pool chunk": их время — суммарная занятость исполнителей.
+// GFN_TRACE=FILE дополнительно пишет каждое событие в Chrome trace JSON
+// (chrome://tracing, Perfetto): по строке на исполнителя.
+
+#ifdef GFN_PROFILE
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include <sys/stat.h>
+
+class Profiler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static Profiler& instance() {
+        static Profiler p;
+        return p;
+    }
+
+    void record(const char* name, Clock::time_point t0, Clock::time_point t1, uint64_t items) {
+        std::lock_guard<std::mutex> lk(m_);
+        Stage& s = stage(name);
+        s.calls++;
+        s.sec += std::chrono::duration<double>(t1 - t0).count();
+        s.items += items;
+        if (tracePath_)
+            events_.push_back({name, micros(t0), micros(t1) - micros(t0), threadId()});
+    }
+
+    void count(const char* name, uint64_t n) {
+        std::lock_guard<std::mutex> lk(m_);
+        for (auto& c : counters_)
+            if (c.first == name) {
+                c.second += n;
+                return;
+            }
+        counters_.push_back({name, n});
+    }
+
+    ~Profiler() {
+        report();
+        if (tracePath_) writeTrace();
+    }
+
+private:
+    struct Stage {
+        std::string name;
+        uint64_t calls = 0;
+        double sec = 0;
+        uint64_t items = 0;
+    };
+    struct Event {
+        const char* name;
+        uint64_t ts, dur;
+        unsigned tid;
+    };
+
+    Profiler() : start_(Clock::now()), tracePath_(std::getenv("GFN_TRACE")) {}
+
+    // Этапов единицы-десятки: линейный поиск по имени, порядок — первого появления
+    Stage& stage(const char* name) {
+        for (auto& s : stages_)
+            if (s.name == name) return s;
+        stages_.emplace_back();
+        stages_.back().name = name;
+        return stages_.back();
+    }
+
+    uint64_t micros(Clock::time_point t) const {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(t - start_).count();
+    }
+
+    static unsigned threadId() {
+        static std::atomic<unsigned> next(0);
+        static thread_local unsigned id = next++;
+        return id;
+    }
+
+    void report() {
+        double wall = std::chrono::duration<double>(Clock::now() - start_).count();
+        fprintf(stderr, "\n--- Profile (%.3f s) ---\n", wall);
+        fprintf(stderr, "%-20s %8s %10s %7s %14s %12s\n", "stage", "calls", "time, s", "%", "items", "items/s");
+        for (const auto& s : stages_) {
+            fprintf(stderr, "%-20s %8llu %10.4f %6.1f%% ", s.name.c_str(), (unsigned long long)s.calls, s.sec,
+                    wall > 0 ? 100 * s.sec / wall : 0.0);
+            if (s.items) fprintf(stderr, "%14llu %12.4g\n", (unsigned long long)s.items, s.sec > 0 ? s.items / s.sec : 0.0);
+            else fprintf(stderr, "%14s %12s\n", "-", "-");
+        }
+        for (const auto& c : counters_)
+            fprintf(stderr, "%-20s %28s %14llu\n", c.first.c_str(), "", (unsigned long long)c.second);
+    }
+
+    void writeTrace() {
+        FILE* f = fopen(tracePath_, "w");
+        if (!f) {
+            fprintf(stderr, "Warning: cannot write trace %s\n", tracePath_);
+            return;
+        }
+        fprintf(f, "{\"traceEvents\": [\n");
+        for (size_t i = 0; i < events_.size(); ++i) {
+            const Event& e = events_[i];
+            fprintf(f, "  {\"name\": \"%s\", \"ph\": \"X\", \"ts\": %llu, \"dur\": %llu, \"pid\": 1, \"tid\": %u}%s\n",
+                    e.name, (unsigned long long)e.ts, (unsigned long long)e.dur, e.tid,
+                    i + 1 < events_.size() ? "," : "");
+        }
+        fprintf(f, "]}\n");
+        fclose(f);
+        fprintf(stderr, "Trace: %zu events saved to %s\n", events_.size(), tracePath_);
+    }
+
+    std::mutex m_;
+    Clock::time_point start_;
+    const char* tracePath_;
+    std::vector<Stage> stages_;
+    std::vector<std::pair<std::string, uint64_t>> counters_;
+    std::vector<Event> events_;
+};
+
+// Создается при статической инициализации: время в сводке — от старта процесса
+inline Profiler& profilerAtStartup = Profiler::instance();
+
+// Размер файла для счетчиков прочитанного текста (0, если файла нет)
+inline uint64_t profileFileSize(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+class ProfileTimer {
+public:
+    explicit ProfileTimer(const char* name) : name_(name), t0_(Profiler::Clock::now()) {}
+    ~ProfileTimer() { stop(0); }
+
+    void stop(uint64_t items) {
+        if (!name_) return;
+        Profiler::instance().record(name_, t0_, Profiler::Clock::now(), items);
+        name_ = nullptr;
+    }
+
+private:
+    const char* name_;
+    Profiler::Clock::time_point t0_;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name) ProfileTimer PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_STAGE(var, name) ProfileTimer profileStage_##var(name)
+#define PROFILE_STAGE_END(var, items) profileStage_##var.stop(items)
+#define PROFILE_COUNT(name, n) Profiler::instance().count(name, (uint64_t)(n))
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_STAGE(var, name) ((void)0)
+#define PROFILE_STAGE_END(var, items) ((void)0)
+#define PROFILE_COUNT(name, n) ((void)0)
+
+#endif // GFN_PROFILE
+
+#endif // INSTRUMENT_H
@@ -0,0 +1,94 @@
+#ifndef LAST_ROUND_H
+#define LAST_ROUND_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "thread_pool.h"
+#include "instrument.h"
+
+// --- ОЦЕНКА КЛЮЧА ПОСЛЕДНЕГО РАУНДА ---
+//
+// После отката раунда ключом k:  Z = (Y3 ^ F(Y1, Y2, k), Y0, Y1, Y2).
+// Значит нибблы 1..3 разности dZ равны нибблам 0..2 разности dY = Y ^ Y'
+// и от ключа не зависят: пары, у которых они не совпадают с целью,
+// отбрасываются до перебора ключей.
+
+// Ключонезависимый фильтр: (dZ & 0x0FFF) == (dY >> 4)
+inline bool lastRoundFilter(uint16_t y, uint16_t yp, uint16_t targetDz) {
+    return (uint16_t)((y ^ yp) >> 4) == (targetDz & 0x0FFF);
+}
+
+// Таблица частичного отката: ниббл k слова FK[(a << 4) | b] равен F(a, b, k).
+// Один поиск в таблице дает F сразу для всех 16 ключей. От ключей шифра
+// не зависит, только от S-Box.
+struct LastRoundTable {
+    uint64_t FK[256];
+
+    explicit LastRoundTable(const CipherSpec& c) {
+        for (int v = 0; v < 256; ++v) {
+            uint64_t w = 0;
+            for (int k = 0; k < 16; ++k)
+                w |= (uint64_t)c.F((uint8_t)(v >> 4), (uint8_t)(v & 0xF), (uint8_t)k) << (4 * k);
+            FK[v] = w;
+        }
+    }
+};
+
+inline const LastRoundTable& lastRoundTable() {
+    static const LastRoundTable t(activeCipher());
+    return t;
+}
+
+// Прибавляет к scores[k] число пар, у которых после отката раунда
+// ключом k разность равна targetDz (k = 0..15).
+// Разность старшего ниббла dZ для всех ключей — слово из 16 нибблов:
+//   FK[Y1,Y2] ^ FK[Y1',Y2'] ^ (Y3 ^ Y3'), попадание — нулевой ниббл
+// (при условии фильтра). Нулевые нибблы собираются в 4 аккумулятора
+// с 16-битными полями, без ветвлений.
+inline void scoreLastRound(const uint16_t* Y, const uint16_t* Yp, size_t n,
+                           uint16_t targetDz, long long scores[16]) {
+    const uint64_t* FK = lastRoundTable().FK;
+    const uint64_t NIBBLE_LSB = 0x1111111111111111ULL;
+    const uint64_t LANE_LSB = 0x0001000100010001ULL;
+    const int top = targetDz >> 12;
+
+    for (size_t i0 = 0; i0 < n; i0 += 0xFFFF) {
+        size_t i1 = (n - i0 < 0xFFFF) ? n : i0 + 0xFFFF;
+        // acc[j]: поле m (16 бит) — счетчик ключа 4 * m + j
+        uint64_t acc[4] = {0, 0, 0, 0};
+        for (size_t i = i0; i < i1; ++i) {
+            uint16_t y = Y[i], yp = Yp[i];
+            uint64_t v = FK[(y >> 4) & 0xFF] ^ FK[(yp >> 4) & 0xFF] ^
+                         (NIBBLE_LSB * (uint64_t)(((y ^ yp) & 0xF) ^ top));
+            uint64_t zero = ~(v | (v >> 1) | (v >> 2) | (v >> 3)) & NIBBLE_LSB;
+            zero &= -(uint64_t)lastRoundFilter(y, yp, targetDz);
+            acc[0] += zero & LANE_LSB;
+            acc[1] += (zero >> 4) & LANE_LSB;
+            acc[2] += (zero >> 8) & LANE_LSB;
+            acc[3] += (zero >> 12) & LANE_LSB;
+        }
+        for (int j = 0; j < 4; ++j)
+            for (int m = 0; m < 4; ++m)
+                scores[4 * m + j] += (acc[j] >> (16 * m)) & 0xFFFF;
+    }
+}
+
+// То же в общем пуле (thread_pool.h): свои счетчики у каждого исполнителя
+inline void scoreLastRoundParallel(const uint16_t* Y, const uint16_t* Yp, size_t n,
+                                   uint16_t targetDz, long long scores[16]) {
+    typedef std::array<long long, 16> Scores;
+    PROFILE_STAGE(score, "score last round");
+    Scores total = parallelReduce(
+        0, n, PARALLEL_GRAIN, Scores{},
+        [&](size_t b, size_t e, Scores& acc) { scoreLastRound(Y + b, Yp + b, e - b, targetDz, acc.data()); },
+        [](Scores& a, const Scores& l) { for (int k = 0; k < 16; ++k) a[k] += l[k]; });
+    for (int k = 0; k < 16; ++k) scores[k] += total[k];
+    PROFILE_STAGE_END(score, n);
+}
+
+#endif // LAST_ROUND_H
@@ -0,0 +1,61 @@
+#ifndef LAT_TABLE_H
+#define LAT_TABLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+
+// --- ТАБЛИЦЫ КОРРЕЛЯЦИЙ S-БЛОКА И ФУНКЦИИ F ---
+//
+// LAT[a][b] = sum_x (-1)^{a.x ^ b.G(x)} (от -16 до 16), корреляция
+// c_G(a -> b) = LAT[a][b] / 16. Для F(x2, x3, k) = G(x2 ^ G(k ^ x3))
+// маска выхода m задает единственный путь: m.G(t) ~ a.t, затем
+// a.G(x3 ^ k) ~ b.x3, поэтому
+//   c_F((a, b) -> m) = c_G(a -> m) * c_G(b -> a) * (-1)^{b.k}.
+// Знак зависит от ключа, квадрат — нет: поиск траекторий ведется по
+// c^2 (ELP), как дифференциальный — по вероятностям DDT (ddt_table.h).
+// Таблицы строятся на лету: 16 * 256 произведений.
+
+// Ненулевое приближение F для выходной маски m: входные маски (a, b)
+struct FMaskTransition {
+    double corr2;  // c_F^2
+    double corr;   // c_F при k = 0
+    uint8_t a, b;  // маски x2, x3
+};
+
+struct LatTables {
+    int sbox[16][16];                 // LAT S-блока
+    double fCorr[16][256];            // c_F при k = 0: [m][(a << 4) | b]
+    // Ненулевые приближения F для маски m, по убыванию c_F^2
+    FMaskTransition fList[16][256];
+    uint16_t fNum[16];
+};
+
+inline void buildSboxLat(int lat[16][16], const CipherSpec& c = activeCipher()) {
+    for (int a = 0; a < 16; ++a)
+        for (int b = 0; b < 16; ++b) {
+            int s = 0;
+            for (int x = 0; x < 16; ++x) s += 1 - 2 * (int)parity((a & x) ^ (b & c.G(x)));
+            lat[a][b] = s;
+        }
+}
+
+inline void buildLatTables(LatTables& t, const CipherSpec& c = activeCipher()) {
+    buildSboxLat(t.sbox, c);
+    for (int m = 0; m < 16; ++m) {
+        int n = 0;
+        for (int v = 0; v < 256; ++v) {
+            int a = v >> 4, b = v & 0xF;
+            double corr = (t.sbox[a][m] / 16.0) * (t.sbox[b][a] / 16.0);
+            t.fCorr[m][v] = corr;
+            if (corr != 0) t.fList[m][n++] = FMaskTransition{corr * corr, corr, (uint8_t)a, (uint8_t)b};
+        }
+        t.fNum[m] = (uint16_t)n;
+        std::stable_sort(t.fList[m], t.fList[m] + n,
+                         [](const FMaskTransition& x, const FMaskTransition& y) { return x.corr2 > y.corr2; });
+    }
+}
+
+#endif // LAT_TABLE_H
@@ -0,0 +1,72 @@
+#ifndef LINEAR_KEY_H
+#define LINEAR_KEY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "walsh.h"
+
+// --- МАЦУИ-2 ПО ТАБЛИЦЕ СЧЕТЧИКОВ ---
+//
+// После отката последнего раунда ключом k:
+//   C5 = (Y3 ^ F(Y1, Y2, k), Y0, Y1, Y2),
+// поэтому бит уравнения alpha.P ^ beta.C5 раскладывается на
+//   b(P, Y) = alpha.P ^ (beta & 0x0FFF).(Y >> 4) ^ m0.Y3    — от ключа не зависит,
+//   m0.F(Y1, Y2, k),                                        где m0 = beta >> 12.
+// Данные сжимаются за один проход в таблицу T[(Y1 << 4) | Y2] =
+// #(b = 0) - #(b = 1). Для ключа k сумма
+//   S(k) = sum_{a,b} T[a,b] * (-1)^{m0.G(a ^ G(b ^ k))}
+// — XOR-свертка по b, она считается через FWHT размера 16 для каждого a.
+// Совпадений уравнения для ключа k: (N + S(k)) / 2. Стоимость оценки
+// ключей от N не зависит.
+
+// Маски 5-раундового приближения (linear_result_5_rounds.txt, Rank 1):
+// общие для генератора (адаптивная остановка) и атаки
+const uint16_t LINEAR_TARGET_MASK_IN = 0x4;
+const uint16_t LINEAR_TARGET_MASK_OUT = 0x2140;
+
+struct LinearCountTable {
+    int64_t T[256];
+    uint64_t n;
+
+    LinearCountTable() { clear(); }
+    void clear() { memset(T, 0, sizeof(T)); n = 0; }
+};
+
+// Ключонезависимый бит уравнения для пары (P, Y)
+inline uint8_t linearPairBit(uint16_t p, uint16_t y, uint16_t maskIn, uint16_t maskOut) {
+    return parity(p & maskIn) ^ parity((maskOut & 0x0FFF) & (y >> 4)) ^
+           parity((maskOut >> 12) & y & 0xF);
+}
+
+inline void linearCountPairs(const uint16_t* P, const uint16_t* Y, size_t n,
+                             uint16_t maskIn, uint16_t maskOut, LinearCountTable& t) {
+    for (size_t i = 0; i < n; ++i)
+        t.T[(Y[i] >> 4) & 0xFF] += 1 - 2 * (int)linearPairBit(P[i], Y[i], maskIn, maskOut);
+    t.n += n;
+}
+
+// matches[k] — число пар, для которых уравнение выполняется с ключом k
+inline void linearScoreKeys(const LinearCountTable& t, uint16_t maskOut, long long matches[16]) {
+    int64_t S[16] = {0};
+    const CipherSpec& c = activeCipher();
+    uint8_t m0 = (uint8_t)(maskOut >> 12);
+    for (int a = 0; a < 16; ++a) {
+        // g(u) = (-1)^{m0.G(a ^ G(u))}, S_a(k) = sum_b T[a,b] g(b ^ k)
+        int64_t tf[16], gf[16];
+        for (int u = 0; u < 16; ++u) {
+            tf[u] = t.T[(a << 4) | u];
+            gf[u] = 1 - 2 * (int64_t)parity(m0 & c.G((uint8_t)(a ^ c.G((uint8_t)u))));
+        }
+        fwht(tf, 16);
+        fwht(gf, 16);
+        for (int u = 0; u < 16; ++u) tf[u] *= gf[u];
+        fwht(tf, 16); // обратное FWHT = прямое / 16
+        for (int k = 0; k < 16; ++k) S[k] += tf[k] / 16;
+    }
+    for (int k = 0; k < 16; ++k) matches[k] = ((long long)t.n + S[k]) / 2;
+}
+
+#endif // LINEAR_KEY_H
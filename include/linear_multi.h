@@ -0,0 +1,171 @@
+#ifndef LINEAR_MULTI_H
+#define LINEAR_MULTI_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "linear_key.h"
+#include "pair_io.h"
+#include "thread_pool.h"
+#include "instrument.h"
+
+// --- МНОГОМЕРНЫЙ ЛИНЕЙНЫЙ АНАЛИЗ (chi^2 / LLR) ---
+//
+// m приближений (alpha_i, beta_i) дают для пары (P, Y) и ключа k вектор
+// четностей v (бит i — уравнение i после отката раунда ключом k).
+// Как и в linear_key.h, v = b(P, Y) ^ f(Y1, Y2, k), где b от ключа не
+// зависит, а f_i = m0_i . F(Y1, Y2, k), m0_i = beta_i >> 12. Поэтому
+// данные за один проход сжимаются в таблицу T[(Y1 << 4) | Y2][b]
+// (по потокам — свои таблицы), а гистограммы 2^m значений v для всех 16
+// ключей строятся из нее за 16 * 256 * 2^m, независимо от N.
+//
+// Ключи ранжируются по
+//   chi^2 = sum_v (H_k[v] - N / 2^m)^2 / (N / 2^m)   — отклонение от равномерного,
+//   LLR   = sum_v H_k[v] * log2(p(v) * 2^m)          — p — распределение v для
+//           R - 1 раундов по кодбуку (как смещения в linear_search).
+
+const int LINEAR_MULTI_MAX_DIM = 8;
+
+struct LinearApprox {
+    uint16_t maskIn, maskOut;
+    double bias;
+};
+
+// Строки "MaskIn=0x.. -> MaskOut=0x.. | Bias=..." из linear_result_5_rounds.txt
+// или "a0 a1 a2 a3 b0 b1 b2 b3 ELP" из linear_trail_results.txt
+// (|bias| = sqrt(ELP) / 2, знак от ключа не известен)
+inline std::vector<LinearApprox> readLinearResults(const std::string& path) {
+    std::vector<LinearApprox> list;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        unsigned a, b;
+        int v[8];
+        double bias;
+        if (sscanf(line.c_str(), "MaskIn=0x%x -> MaskOut=0x%x | Bias=%lf", &a, &b, &bias) == 3)
+            list.push_back({(uint16_t)a, (uint16_t)b, bias});
+        else if (sscanf(line.c_str(), "%d %d %d %d %d %d %d %d %lf", &v[0], &v[1], &v[2], &v[3],
+                        &v[4], &v[5], &v[6], &v[7], &bias) == 9)
+            list.push_back({packNibbles(v), packNibbles(v + 4), std::sqrt(bias) / 2});
+    }
+    return list;
+}
+
+// Первые m линейно независимых приближений (векторы alpha || beta над GF(2)):
+// зависимое приближение не добавляет информации, только дублирует биты v
+inline std::vector<LinearApprox> selectIndependent(const std::vector<LinearApprox>& list, int m) {
+    std::vector<LinearApprox> out;
+    std::vector<uint32_t> basis; // приведенные векторы, по старшему биту
+    for (const auto& a : list) {
+        if ((int)out.size() >= m) break;
+        uint32_t v = ((uint32_t)a.maskIn << 16) | a.maskOut;
+        for (uint32_t b : basis) v = std::min(v, v ^ b);
+        if (v == 0) continue;
+        basis.push_back(v);
+        std::sort(basis.rbegin(), basis.rend());
+        out.push_back(a);
+    }
+    return out;
+}
+
+struct MultiLinearTable {
+    int m = 0;
+    std::vector<uint64_t> T; // [(Y1 << 4) | Y2][b], 256 * 2^m
+    uint64_t n = 0;
+
+    void reset(int dim) {
+        m = dim;
+        T.assign((size_t)256 << m, 0);
+        n = 0;
+    }
+};
+
+// Ключонезависимая часть вектора четностей
+inline uint32_t multiLinearBase(const std::vector<LinearApprox>& ap, uint16_t p, uint16_t y) {
+    uint32_t b = 0;
+    for (size_t i = 0; i < ap.size(); ++i)
+        b |= (uint32_t)linearPairBit(p, y, ap[i].maskIn, ap[i].maskOut) << i;
+    return b;
+}
+
+inline void multiLinearCount(const std::vector<LinearApprox>& ap, const uint16_t* P,
+                             const uint16_t* Y, size_t n, MultiLinearTable& t) {
+    for (size_t i = 0; i < n; ++i)
+        t.T[((size_t)((Y[i] >> 4) & 0xFF) << t.m) | multiLinearBase(ap, P[i], Y[i])]++;
+    t.n += n;
+}
+
+// Проход в общем пуле: у каждого исполнителя своя таблица, затем сложение
+inline void multiLinearCountParallel(const std::vector<LinearApprox>& ap, const uint16_t* P,
+                                     const uint16_t* Y, size_t n, MultiLinearTable& t) {
+    PROFILE_STAGE(count, "count parities");
+    MultiLinearTable empty;
+    empty.reset(t.m);
+    MultiLinearTable sum = parallelReduce(
+        0, n, PARALLEL_GRAIN, empty,
+        [&](size_t b, size_t e, MultiLinearTable& acc) { multiLinearCount(ap, P + b, Y + b, e - b, acc); },
+        [](MultiLinearTable& a, const MultiLinearTable& l) {
+            for (size_t c = 0; c < a.T.size(); ++c) a.T[c] += l.T[c];
+            a.n += l.n;
+        });
+    for (size_t c = 0; c < t.T.size(); ++c) t.T[c] += sum.T[c];
+    t.n += sum.n;
+    PROFILE_STAGE_END(count, n);
+}
+
+// hist[k * 2^m + v] — число пар с вектором v для ключа k
+inline std::vector<uint64_t> multiLinearHistograms(const MultiLinearTable& t,
+                                                   const std::vector<LinearApprox>& ap) {
+    const CipherSpec& c = activeCipher();
+    const size_t bins = (size_t)1 << t.m;
+    std::vector<uint64_t> hist(16 * bins, 0);
+    for (int k = 0; k < 16; ++k) {
+        uint64_t* h = &hist[k * bins];
+        for (int ab = 0; ab < 256; ++ab) {
+            uint8_t f = c.F((uint8_t)(ab >> 4), (uint8_t)(ab & 0xF), (uint8_t)k);
+            uint32_t fv = 0;
+            for (size_t i = 0; i < ap.size(); ++i)
+                fv |= (uint32_t)parity((ap[i].maskOut >> 12) & f) << i;
+            const uint64_t* row = &t.T[(size_t)ab << t.m];
+            for (size_t b = 0; b < bins; ++b) h[b ^ fv] += row[b];
+        }
+    }
+    return hist;
+}
+
+// Точное распределение v для R - 1 раундов: E — таблица кодбука E_{R-1}
+inline std::vector<double> multiLinearDistribution(const std::vector<LinearApprox>& ap,
+                                                   const uint16_t* E) {
+    std::vector<double> p((size_t)1 << ap.size(), 0.0);
+    for (uint32_t x = 0; x < 65536; ++x) {
+        uint32_t v = 0;
+        for (size_t i = 0; i < ap.size(); ++i)
+            v |= (uint32_t)(parity(ap[i].maskIn & x) ^ parity(ap[i].maskOut & E[x])) << i;
+        p[v] += 1.0 / 65536;
+    }
+    return p;
+}
+
+inline double multiLinearChi2(const uint64_t* h, size_t bins, uint64_t n) {
+    double e = (double)n / bins, s = 0;
+    for (size_t v = 0; v < bins; ++v) s += (h[v] - e) * (h[v] - e) / e;
+    return s;
+}
+
+inline double multiLinearLlr(const uint64_t* h, const std::vector<double>& p) {
+    const double bins = (double)p.size();
+    const double floorP = 1.0 / (65536.0 * 16); // v вне носителя p: большой, но конечный штраф
+    double s = 0;
+    for (size_t v = 0; v < p.size(); ++v)
+        if (h[v]) s += h[v] * std::log2(std::max(p[v], floorP) * bins);
+    return s;
+}
+
+#endif // LINEAR_MULTI_H
@@ -0,0 +1,203 @@
+#ifndef MULTI_DIFF_H
+#define MULTI_DIFF_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <cctype>
+#include "cipher_engine.h"
+#include "last_round.h"
+#include "thread_pool.h"
+#include "instrument.h"
+
+// --- МНОЖЕСТВЕННЫЕ И УСЕЧЕННЫЕ ДИФФЕРЕНЦИАЛЫ (LLR) ---
+//
+// Вместо одной dY ключ последнего раунда оценивается по набору целей:
+//   множественный режим — все (dX, dY_i, p_i) из файла траекторий,
+//   усеченный режим     — для каждой dX класс dZ по шаблону нибблов
+//                          ("000*": три нулевых ниббла и любой ненулевой),
+//                          P класса — сумма p_i попавших в него dY_i.
+// Вес значения dZ — логарифм отношения правдоподобия "верный ключ /
+// случайная перестановка" (q = 2^-16 на значение):
+//   w(dZ) = log2(p(dZ) / q(dZ)) - w0,  w0 = log2((1 - P) / (1 - Q)),
+// где P, Q — суммарные вероятности целей; w0 — вес любой другой dZ,
+// он одинаков для всех ключей и вычтен. Счет ключа — сумма w по парам.
+//
+// После отката раунда ключом k младшие 12 бит dZ равны (dY >> 4) и от
+// ключа не зависят (как в last_round.h), поэтому пара отбирается по
+// строке row(dX, dY >> 4) до перебора ключей. Для отобранных пар один
+// поиск FK дает старший ниббл dZ сразу для всех 16 ключей; за проход
+// копятся целые счетчики cnt[row][k][t], веса применяются один раз в
+// конце (scoreMultiDiff).
+
+const int MULTI_DIFF_LOW_VALUES = 4096; // значений младших 12 бит dZ
+
+struct MultiDiffTarget {
+    uint16_t dX, dY;
+    double prob;
+};
+
+// Ниббл j (0 — старший) шаблона: цифра 0..f — точное значение,
+// '*' — любое ненулевое, '?' — любое. Шаблон разбирается один раз:
+// точные нибблы — маска и значение, '*' — бит j в nonzero.
+struct TruncatedPattern {
+    uint16_t mask = 0, value = 0;
+    uint8_t nonzero = 0;
+};
+
+inline int hexNibble(char c) {
+    return isdigit((unsigned char)c) ? c - '0' : tolower((unsigned char)c) - 'a' + 10;
+}
+
+inline TruncatedPattern decodeTruncatedPattern(const std::string& pattern) {
+    TruncatedPattern t;
+    for (int j = 0; j < 4; ++j) {
+        char c = pattern[j];
+        int shift = 12 - 4 * j;
+        if (c == '*') t.nonzero |= (uint8_t)(1 << j);
+        else if (c != '?') {
+            t.mask |= (uint16_t)(0xF << shift);
+            t.value |= (uint16_t)(hexNibble(c) << shift);
+        }
+    }
+    return t;
+}
+
+inline bool truncatedMatch(const TruncatedPattern& t, uint16_t d) {
+    if ((d & t.mask) != t.value) return false;
+    for (int j = 0; j < 4; ++j)
+        if (((t.nonzero >> j) & 1) && ((d >> (12 - 4 * j)) & 0xF) == 0) return false;
+    return true;
+}
+
+inline bool validTruncatedPattern(const std::string& pattern) {
+    if (pattern.size() != 4) return false;
+    for (char c : pattern)
+        if (c != '*' && c != '?' && !isxdigit((unsigned char)c)) return false;
+    return true;
+}
+
+struct MultiDiffModel {
+    std::vector<int16_t> dxIndex;              // [dX] -> индекс входной разности или -1
+    std::vector<uint16_t> dXs;
+    std::vector<int32_t> rowOf;                // [dxIdx * 4096 + (dZ & 0x0FFF)] -> строка или -1
+    std::vector<std::array<double, 16>> weight; // [строка][старший ниббл dZ]
+    std::vector<uint16_t> member;              // [строка]: бит t — dZ с этим нибблом — цель
+    std::vector<size_t> targets;               // значений dZ с весом, на dX
+    std::vector<double> mass;                  // P на dX
+
+    size_t rows() const { return weight.size(); }
+
+    // targets — записи файла траекторий; pattern пуст — множественный режим
+    void build(const std::vector<MultiDiffTarget>& list, const std::string& pattern) {
+        dxIndex.assign(65536, -1);
+        dXs.clear();
+        for (const auto& t : list) {
+            if (dxIndex[t.dX] >= 0) continue;
+            dxIndex[t.dX] = (int16_t)dXs.size();
+            dXs.push_back(t.dX);
+        }
+        rowOf.assign(dXs.size() * MULTI_DIFF_LOW_VALUES, -1);
+        weight.clear();
+        member.clear();
+        targets.assign(dXs.size(), 0);
+        mass.assign(dXs.size(), 0.0);
+
+        const TruncatedPattern trunc = pattern.empty() ? TruncatedPattern() : decodeTruncatedPattern(pattern);
+
+        // Вероятности dZ по dX (truncated — одна сумма на класс)
+        std::vector<std::vector<double>> p(dXs.size());
+        for (auto& v : p) v.assign(65536, 0.0);
+        for (const auto& t : list) {
+            if (!pattern.empty() && !truncatedMatch(trunc, t.dY)) continue;
+            p[dxIndex[t.dX]][t.dY] += t.prob;
+        }
+        for (size_t d = 0; d < dXs.size(); ++d) {
+            std::vector<uint8_t> in(65536, 0);
+            double P = 0;
+            size_t m = 0;
+            for (int z = 1; z < 65536; ++z) {
+                in[z] = pattern.empty() ? p[d][z] > 0 : truncatedMatch(trunc, (uint16_t)z);
+                if (in[z]) { P += p[d][z]; ++m; }
+            }
+            if (P <= 0 || P >= 1) continue;
+            double Q = m / 65536.0;
+            double w0 = std::log2((1 - P) / (1 - Q));
+            double wClass = std::log2(P / Q) - w0;
+            targets[d] = m;
+            mass[d] = P;
+            for (int z = 1; z < 65536; ++z) {
+                if (!in[z]) continue;
+                int32_t& r = rowOf[d * MULTI_DIFF_LOW_VALUES + (z & 0x0FFF)];
+                if (r < 0) {
+                    r = (int32_t)weight.size();
+                    weight.emplace_back();
+                    weight.back().fill(0.0);
+                    member.push_back(0);
+                }
+                member[r] |= (uint16_t)(1 << (z >> 12));
+                weight[r][z >> 12] = pattern.empty() ? std::log2(p[d][z] * 65536.0) - w0 : wClass;
+            }
+        }
+    }
+};
+
+// cnt[row * 256 + k * 16 + t] += число пар строки row, у которых после
+// отката ключом k старший ниббл dZ равен t
+inline void countMultiDiff(const MultiDiffModel& m, const uint16_t* dX, const uint16_t* Y,
+                           const uint16_t* Yp, size_t n, uint32_t* cnt) {
+    const uint64_t* FK = lastRoundTable().FK;
+    const uint64_t NIBBLE_LSB = 0x1111111111111111ULL;
+    for (size_t i = 0; i < n; ++i) {
+        int d = m.dxIndex[dX[i]];
+        if (d < 0) continue;
+        uint16_t y = Y[i], yp = Yp[i];
+        int32_t r = m.rowOf[(size_t)d * MULTI_DIFF_LOW_VALUES + ((y ^ yp) >> 4)];
+        if (r < 0) continue;
+        uint64_t v = FK[(y >> 4) & 0xFF] ^ FK[(yp >> 4) & 0xFF] ^
+                     (NIBBLE_LSB * (uint64_t)((y ^ yp) & 0xF));
+        uint32_t* c = cnt + (size_t)r * 256;
+        for (int k = 0; k < 16; ++k) c[k * 16 + ((v >> (4 * k)) & 0xF)]++;
+    }
+}
+
+// Счетчики в общем пуле: свои у каждого исполнителя, сложение в конце
+inline std::vector<uint32_t> countMultiDiffParallel(const MultiDiffModel& m, const uint16_t* dX,
+                                                    const uint16_t* Y, const uint16_t* Yp,
+                                                    size_t n) {
+    size_t cells = m.rows() * 256;
+    PROFILE_STAGE(count, "count multi diff");
+    std::vector<uint32_t> cnt = parallelReduce(
+        0, n, PARALLEL_GRAIN, std::vector<uint32_t>(cells, 0),
+        [&](size_t b, size_t e, std::vector<uint32_t>& acc) {
+            countMultiDiff(m, dX + b, Y + b, Yp + b, e - b, acc.data());
+        },
+        [cells](std::vector<uint32_t>& a, const std::vector<uint32_t>& l) {
+            for (size_t c = 0; c < cells; ++c) a[c] += l[c];
+        });
+    PROFILE_STAGE_END(count, n);
+    return cnt;
+}
+
+// LLR-счет ключей и число попаданий в цели
+inline void scoreMultiDiff(const MultiDiffModel& m, const std::vector<uint32_t>& cnt,
+                           double llr[16], long long hits[16]) {
+    for (int k = 0; k < 16; ++k) {
+        llr[k] = 0;
+        hits[k] = 0;
+    }
+    for (size_t r = 0; r < m.rows(); ++r)
+        for (int k = 0; k < 16; ++k)
+            for (int t = 0; t < 16; ++t) {
+                uint32_t c = cnt[r * 256 + k * 16 + t];
+                if (c == 0 || !((m.member[r] >> t) & 1)) continue;
+                llr[k] += c * m.weight[r][t];
+                hits[k] += c;
+            }
+}
+
+#endif // MULTI_DIFF_H
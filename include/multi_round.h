@@ -0,0 +1,129 @@
+#ifndef MULTI_ROUND_H
+#define MULTI_ROUND_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "last_round.h"
+#include "instrument.h"
+
+// --- СОВМЕСТНЫЙ ПЕРЕБОР КЛЮЧЕЙ ПОСЛЕДНИХ L РАУНДОВ ---
+//
+// Дифференциал на R - L раундов, откат L раундов (L = 1..3);
+// R и расписание ключей — из activeCipher().
+// Откат раунда:  Z = (Z3 ^ F(Z1, Z2, k), Z0, Z1, Z2) — новый ниббл
+// встает в позицию 0 и дальше только сдвигается. После L откатов
+//   нибблы L..3  = нибблы 0..3-L шифротекста  — от ключей не зависят,
+//   ниббл L-1-s  = ниббл, полученный на шаге s (ключ раунда R - s).
+// Поэтому пары отсекаются до перебора, а на шаге s остаются только
+// ключи, для которых ниббл разности уже совпал с целью (ранний отказ).
+//
+// Кандидат — индекс key = sum_s k_{R-s} << (4 s), 16^L значений.
+
+const int MULTI_ROUND_MAX_PEEL = 3;
+
+// Упакованный decryptOneRound
+inline uint16_t peelRound(uint16_t z, uint8_t k) {
+    const uint64_t* FK = lastRoundTable().FK;
+    uint16_t x0 = (uint16_t)((z & 0xF) ^ ((FK[(z >> 4) & 0xFF] >> (4 * k)) & 0xF));
+    return (uint16_t)((x0 << 12) | (z >> 4));
+}
+
+// Ключонезависимый фильтр: нибблы L..3 разности после отката
+inline bool multiRoundFilter(uint16_t y, uint16_t yp, uint16_t targetDz, int peel) {
+    return (uint16_t)((y ^ yp) >> (4 * peel)) == (uint16_t)(targetDz & (0xFFFF >> (4 * peel)));
+}
+
+inline void multiRoundStep(uint16_t z, uint16_t zp, int s, uint32_t key, uint16_t targetDz,
+                           int peel, long long* scores) {
+    if (s == peel) {
+        scores[key]++;
+        return;
+    }
+    const uint64_t* FK = lastRoundTable().FK;
+    const uint64_t NIBBLE_LSB = 0x1111111111111111ULL;
+    int want = (targetDz >> (12 - 4 * (peel - 1 - s))) & 0xF;
+    uint64_t v = FK[(z >> 4) & 0xFF] ^ FK[(zp >> 4) & 0xFF] ^
+                 (NIBBLE_LSB * (uint64_t)(((z ^ zp) & 0xF) ^ want));
+    uint64_t zero = ~(v | (v >> 1) | (v >> 2) | (v >> 3)) & NIBBLE_LSB;
+    while (zero) {
+        int k = __builtin_ctzll(zero) >> 2;
+        zero &= zero - 1;
+        multiRoundStep(peelRound(z, (uint8_t)k), peelRound(zp, (uint8_t)k), s + 1,
+                       key | ((uint32_t)k << (4 * s)), targetDz, peel, scores);
+    }
+}
+
+// Прибавляет к scores[key] (16^peel элементов) число пар, у которых после
+// отката peel раундов ключами key разность равна targetDz
+inline void scoreMultiRound(const uint16_t* Y, const uint16_t* Yp, size_t n,
+                            uint16_t targetDz, int peel, long long* scores) {
+    for (size_t i = 0; i < n; ++i)
+        if (multiRoundFilter(Y[i], Yp[i], targetDz, peel))
+            multiRoundStep(Y[i], Yp[i], 0, 0, targetDz, peel, scores);
+}
+
+inline void scoreMultiRoundParallel(const uint16_t* Y, const uint16_t* Yp, size_t n,
+                                    uint16_t targetDz, int peel, long long* scores) {
+    size_t keys = (size_t)1 << (4 * peel);
+    PROFILE_STAGE(score, "score multi round");
+    std::vector<long long> total = parallelReduce(
+        0, n, PARALLEL_GRAIN, std::vector<long long>(keys, 0),
+        [&](size_t b, size_t e, std::vector<long long>& acc) {
+            scoreMultiRound(Y + b, Yp + b, e - b, targetDz, peel, acc.data());
+        },
+        [keys](std::vector<long long>& a, const std::vector<long long>& l) {
+            for (size_t k = 0; k < keys; ++k) a[k] += l[k];
+        });
+    for (size_t k = 0; k < keys; ++k) scores[k] += total[k];
+    PROFILE_STAGE_END(score, n);
+}
+
+// Кандидат -> нибблы мастер-ключа. fixedMask — какие нибблы t1..t4 заданы
+// (бит 3 - i для t_{i+1}); false, если ключи противоречат расписанию.
+inline bool multiRoundToMaster(uint32_t key, int peel, uint16_t& master, int& fixedMask) {
+    master = 0;
+    fixedMask = 0;
+    for (int s = 0; s < peel; ++s) {
+        int r = activeCipher().rounds - 1 - s; // индекс раунда с нуля
+        int t = r % MASTER_KEY_NIBBLES;
+        uint16_t k = (key >> (4 * s)) & 0xF;
+        int shift = 12 - 4 * t;
+        if ((fixedMask >> (3 - t)) & 1) {
+            if (((master >> shift) & 0xF) != k) return false;
+        } else {
+            master |= (uint16_t)(k << shift);
+            fixedMask |= 1 << (3 - t);
+        }
+    }
+    return true;
+}
+
+// Дополняет свободные нибблы мастер-ключа перебором и проверяет
+// кандидатов на известных парах (X, E(X)). true — ключ найден.
+inline bool completeMasterKey(uint16_t partial, int fixedMask, const uint16_t* X,
+                              const uint16_t* Y, size_t n, uint16_t& master) {
+    int freeNibbles[MASTER_KEY_NIBBLES], numFree = 0;
+    for (int t = 0; t < MASTER_KEY_NIBBLES; ++t)
+        if (!((fixedMask >> (3 - t)) & 1)) freeNibbles[numFree++] = t;
+
+    for (uint32_t g = 0; g < (1u << (4 * numFree)); ++g) {
+        uint16_t m = partial;
+        for (int j = 0; j < numFree; ++j)
+            m |= (uint16_t)(((g >> (4 * j)) & 0xF) << (12 - 4 * freeNibbles[j]));
+        CipherSpec c = activeCipher();
+        c.setMaster(m);
+        size_t i = 0;
+        while (i < n && c.encrypt(X[i]) == Y[i]) ++i;
+        if (i == n) {
+            master = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // MULTI_ROUND_H
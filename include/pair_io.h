@@ -0,0 +1,191 @@
+#ifndef PAIR_IO_H
+#define PAIR_IO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "instrument.h"
+
+// --- БИНАРНЫЙ ФОРМАТ ПАР (pairs_data.bin) ---
+//
+// Колоночный формат для атаки с выбранными открытыми текстами:
+//   PairFileHeader
+//   X[count]   uint16 — открытый текст (packBlock)
+//   dX[count]  uint16 — входная разность
+//   Y[count]   uint16 — E(X)
+//   Yp[count]  uint16 — E(X ^ dX)
+// В заголовке — целевая траектория и хэш расписания ключей, с которым
+// данные сгенерированы. Читатели отображают файл через mmap.
+//
+// Старый текстовый формат pairs_data.txt (16 чисел на строку:
+// X0..X3 dX0..dX3 Y0..Y3 Yp0..Yp3) поддерживается readPairsText /
+// writePairsText и утилитой pairs_convert.
+
+const char PAIRS_MAGIC[8] = {'G', 'F', 'N', 'P', 'A', 'I', 'R', 'S'};
+const uint32_t PAIRS_VERSION = 1;
+
+struct PairFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint16_t trailDx;      // упакованная dX траектории
+    uint16_t trailDy;      // упакованная dY траектории
+    double trailProb;      // вероятность траектории
+    uint64_t scheduleHash; // cipherScheduleHash() генератора
+    uint64_t count;        // число пар
+};
+
+// Данные в памяти (запись, конвертация)
+struct PairColumns {
+    std::vector<uint16_t> X, dX, Y, Yp;
+
+    void resize(size_t n) {
+        X.resize(n); dX.resize(n); Y.resize(n); Yp.resize(n);
+        PROFILE_COUNT("alloc bytes", 4 * n * sizeof(uint16_t));
+    }
+    size_t size() const { return X.size(); }
+};
+
+inline PairFileHeader makePairHeader(uint16_t trailDx, uint16_t trailDy, double trailProb,
+                                     uint64_t count) {
+    PairFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PAIRS_MAGIC, 8);
+    h.version = PAIRS_VERSION;
+    h.trailDx = trailDx;
+    h.trailDy = trailDy;
+    h.trailProb = trailProb;
+    h.scheduleHash = cipherScheduleHash();
+    h.count = count;
+    return h;
+}
+
+inline bool writePairFile(const std::string& path, PairFileHeader h, const PairColumns& c) {
+    h.count = c.size();
+    PROFILE_STAGE(write, "write pairs");
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    size_t n = c.size();
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(c.X.data(), sizeof(uint16_t), n, f) == n &&
+              fwrite(c.dX.data(), sizeof(uint16_t), n, f) == n &&
+              fwrite(c.Y.data(), sizeof(uint16_t), n, f) == n &&
+              fwrite(c.Yp.data(), sizeof(uint16_t), n, f) == n;
+    ok = (fclose(f) == 0) && ok;
+    PROFILE_COUNT("bytes written", sizeof(h) + 4 * n * sizeof(uint16_t));
+    PROFILE_STAGE_END(write, n);
+    return ok;
+}
+
+// Отображенный только для чтения файл пар
+class PairFile {
+public:
+    PairFile() = default;
+    PairFile(const PairFile&) = delete;
+    PairFile& operator=(const PairFile&) = delete;
+    ~PairFile() { close(); }
+
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PairFileHeader)) {
+            ::close(fd);
+            return false;
+        }
+        size_t size = (size_t)st.st_size;
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+
+        memcpy(&header_, p, sizeof(header_));
+        if (memcmp(header_.magic, PAIRS_MAGIC, 8) != 0 || header_.version != PAIRS_VERSION ||
+            size != sizeof(PairFileHeader) + header_.count * 4 * sizeof(uint16_t)) {
+            std::cerr << "Error: " << path << " is not a valid pair file (version "
+                      << PAIRS_VERSION << ").\n";
+            munmap(p, size);
+            return false;
+        }
+        madvise(p, size, MADV_SEQUENTIAL);
+        PROFILE_COUNT("bytes mapped", size);
+        map_ = p;
+        size_ = size;
+        cols_ = (const uint16_t*)((const char*)p + sizeof(PairFileHeader));
+        return true;
+    }
+
+    void close() {
+        if (map_) munmap(map_, size_);
+        map_ = nullptr;
+        size_ = 0;
+        cols_ = nullptr;
+    }
+
+    const PairFileHeader& header() const { return header_; }
+    size_t count() const { return map_ ? header_.count : 0; }
+    bool matchesSchedule() const { return header_.scheduleHash == cipherScheduleHash(); }
+
+    const uint16_t* X() const { return cols_; }
+    const uint16_t* dX() const { return cols_ + header_.count; }
+    const uint16_t* Y() const { return cols_ + 2 * header_.count; }
+    const uint16_t* Yp() const { return cols_ + 3 * header_.count; }
+
+private:
+    void* map_ = nullptr;
+    size_t size_ = 0;
+    PairFileHeader header_{};
+    const uint16_t* cols_ = nullptr;
+};
+
+// --- СТАРЫЙ ТЕКСТОВЫЙ ФОРМАТ ---
+
+inline uint16_t packNibbles(const int v[4]) {
+    return (uint16_t)(((v[0] & 0xF) << 12) | ((v[1] & 0xF) << 8) | ((v[2] & 0xF) << 4) | (v[3] & 0xF));
+}
+
+inline bool readPairsText(const std::string& path, PairColumns& c) {
+    std::ifstream fin(path);
+    if (!fin.is_open()) return false;
+    PROFILE_STAGE(parse, "parse text");
+    int vals[16];
+    while (fin >> vals[0]) {
+        for (int i = 1; i < 16; ++i) fin >> vals[i];
+        c.X.push_back(packNibbles(vals));
+        c.dX.push_back(packNibbles(vals + 4));
+        c.Y.push_back(packNibbles(vals + 8));
+        c.Yp.push_back(packNibbles(vals + 12));
+    }
+    PROFILE_STAGE_END(parse, c.size());
+    PROFILE_COUNT("bytes read", profileFileSize(path.c_str()));
+    return true;
+}
+
+inline bool writePairsText(const std::string& path, const uint16_t* X, const uint16_t* dX,
+                           const uint16_t* Y, const uint16_t* Yp, size_t n) {
+    std::ofstream fout(path);
+    if (!fout.is_open()) return false;
+    PROFILE_STAGE(write, "write text");
+    for (size_t i = 0; i < n; ++i) {
+        const uint16_t cols[4] = {X[i], dX[i], Y[i], Yp[i]};
+        for (int c = 0; c < 4; ++c) {
+            Block b = unpackBlock(cols[c]);
+            fout << (int)b.x[0] << " " << (int)b.x[1] << " " << (int)b.x[2] << " " << (int)b.x[3]
+                 << (c == 3 ? "\n" : " ");
+        }
+    }
+    PROFILE_STAGE_END(write, n);
+    return (bool)fout;
+}
+
+#endif // PAIR_IO_H
@@ -0,0 +1,137 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+// --- ПРОГРЕСС И ПРОПУСКНАЯ СПОСОБНОСТЬ ДОЛГИХ ПРОХОДОВ ---
+//
+// ProgressMeter meter("Analysis", n);       // n единиц работы (пар, ключей...)
+// parallelFor(..., [&](size_t b, size_t e, unsigned) { ...; meter.add(e - b); });
+// meter.finish();                           // итог: время и единиц/с
+//
+// Исполнители не трогают общий счетчик на каждой паре: add() вызывается
+// раз на кусок работы (десятки тысяч пар), счетчик лежит в своей
+// кэш-линии.
+//
+// Строку "\r<label>: 42.0% (N/total pairs, 3.1M pairs/s)" печатает
+// отдельный поток раз в PROGRESS_INTERVAL_MS; он ждет на условной
+// переменной, поэтому finish() будит его сразу, без хвоста в интервал.
+// Короткий проход, закончившийся до первого интервала, промежуточных строк
+// не печатает.
+
+const int PROGRESS_INTERVAL_MS = 500;
+
+// 3140000 -> "3.14M"
+inline std::string formatRate(double v) {
+    const char* suffix[] = {"", "K", "M", "G"};
+    int s = 0;
+    while (v >= 1000 && s < 3) {
+        v /= 1000;
+        ++s;
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), v < 10 && s ? "%.2f%s" : "%.1f%s", v, suffix[s]);
+    return buf;
+}
+
+class ProgressMeter {
+public:
+    // total = 0 — объем заранее неизвестен, печатается только счетчик
+    ProgressMeter(const std::string& label, uint64_t total, const char* unit = "pairs",
+                  std::ostream& out = std::cout)
+        : label_(label), unit_(unit), total_(total), out_(out),
+          start_(std::chrono::steady_clock::now()) {
+        reporter_ = std::thread([this] { reportLoop(); });
+    }
+
+    ~ProgressMeter() { finish(); }
+
+    ProgressMeter(const ProgressMeter&) = delete;
+    ProgressMeter& operator=(const ProgressMeter&) = delete;
+
+    void add(uint64_t n) { done_.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t done() const { return done_.load(std::memory_order_relaxed); }
+
+    // Останавливает поток печати и выводит итоговую строку (один раз)
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            if (stop_) return;
+            stop_ = true;
+            end_ = std::chrono::steady_clock::now();
+        }
+        cv_.notify_all();
+        reporter_.join();
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.2f", seconds());
+        std::ostringstream line;
+        line << label_ << ": " << done() << " " << unit_ << " in " << buf << " s ("
+             << formatRate(rate()) << " " << unit_ << "/s)";
+        print(line.str());
+        out_ << std::endl;
+    }
+
+    // После finish() — полное время прохода
+    double seconds() const {
+        auto end = stop_ ? end_ : std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start_).count();
+    }
+
+    double rate() const {
+        double s = seconds();
+        return s > 0 ? done() / s : 0;
+    }
+
+private:
+    void reportLoop() {
+        std::unique_lock<std::mutex> lk(m_);
+        while (!cv_.wait_for(lk, std::chrono::milliseconds(PROGRESS_INTERVAL_MS),
+                             [this] { return stop_; })) {
+            uint64_t d = done();
+            std::ostringstream line;
+            line << label_ << ": ";
+            if (total_) {
+                char pct[16];
+                snprintf(pct, sizeof(pct), "%.1f%%", 100.0 * d / total_);
+                line << pct << " (" << d << "/" << total_;
+            } else {
+                line << "(" << d;
+            }
+            line << " " << unit_ << ", " << formatRate(rate()) << " " << unit_ << "/s)";
+            print(line.str());
+        }
+    }
+
+    // Строка поверх предыдущей; хвост более длинной затирается пробелами
+    void print(const std::string& line) {
+        if (width_) out_ << "\r";
+        out_ << line;
+        if (line.size() < width_) out_ << std::string(width_ - line.size(), ' ');
+        width_ = line.size();
+        out_ << std::flush;
+    }
+
+    std::string label_;
+    const char* unit_;
+    uint64_t total_;
+    std::ostream& out_;
+    alignas(64) std::atomic<uint64_t> done_{0};
+    alignas(64) std::mutex m_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    size_t width_ = 0;
+    std::chrono::steady_clock::time_point start_, end_;
+    std::thread reporter_;
+};
+
+#endif // PROGRESS_H
@@ -0,0 +1,69 @@
+#ifndef STRUCTURES_H
+#define STRUCTURES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "cipher_engine.h"
+#include "pair_io.h"
+
+// --- СТРУКТУРЫ ОТКРЫТЫХ ТЕКСТОВ ---
+//
+// Структура — 16^a открытых текстов, у которых a активных нибблов
+// (ненулевые нибблы dX) пробегают все значения, а остальные нибблы
+// фиксированы ("база"). Любая разность, ненулевая только в активных
+// нибблах, разбивает структуру на 16^a / 2 пар, поэтому одна и та же
+// структура дает пары сразу для нескольких dX:
+//   пар = (число dX) * 16^a / 2 на 16^a шифрований
+// против 2 шифрований на пару при случайных X; по всем разностям внутри
+// структуры число пар растет квадратично — 16^a (16^a - 1) / 2.
+// Пары пишутся в обычные колонки PairColumns (X, dX, Y, Yp), так что
+// атака читает их без изменений.
+
+// Маска битов активных нибблов разности
+inline uint16_t structureMask(uint16_t dX) {
+    uint16_t m = 0;
+    for (int j = 0; j < 4; ++j)
+        if ((dX >> (4 * j)) & 0xF) m |= (uint16_t)(0xF << (4 * j));
+    return m;
+}
+
+// Число текстов в структуре с маской mask
+inline size_t structureSize(uint16_t mask) {
+    size_t n = 1;
+    for (int j = 0; j < 4; ++j)
+        if ((mask >> (4 * j)) & 0xF) n *= 16;
+    return n;
+}
+
+// Пар на структуру для набора разностей (все dX внутри mask)
+inline size_t structurePairs(uint16_t mask, size_t numDx) { return numDx * structureSize(mask) / 2; }
+
+// Пишет пары структуры с базой base в out начиная с offset: для каждой
+// dX по одной паре (x, x ^ dX) на неупорядоченную пару, x < x ^ dX.
+// E — таблица шифрования (кодбук). Возвращает число записанных пар.
+inline size_t fillStructurePairs(const uint16_t* E, uint16_t base, uint16_t mask,
+                                 const std::vector<uint16_t>& dXs, PairColumns& out,
+                                 size_t offset) {
+    base &= (uint16_t)~mask;
+    size_t k = offset;
+    for (uint16_t dX : dXs) {
+        // Перебор подмножеств маски: v = (v - mask) & mask
+        uint16_t v = 0;
+        do {
+            uint16_t x = base | v;
+            uint16_t xp = x ^ dX;
+            if (x < xp) {
+                out.X[k] = x;
+                out.dX[k] = dX;
+                out.Y[k] = E[x];
+                out.Yp[k] = E[xp];
+                ++k;
+            }
+            v = (uint16_t)((v - mask) & mask);
+        } while (v != 0);
+    }
+    return k - offset;
+}
+
+#endif // STRUCTURES_H
@@ -0,0 +1,215 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include "instrument.h"
+
+// --- ОБЩИЙ ПУЛ ПОТОКОВ С КРАЖЕЙ РАБОТЫ ---
+//
+// Один пул на процесс (ThreadPool::instance()), потоки живут до выхода.
+// Размер — переменная окружения GFN_THREADS, иначе hardware_concurrency.
+// Вызывающий поток работает как исполнитель 0, поэтому size() —
+// полное число параллельных исполнителей.
+//
+// parallelFor(begin, end, grain, fn): диапазон режется на куски по grain,
+// куски раздаются по очередям исполнителей, свободный исполнитель берет
+// кусок с начала своей очереди, а опустевший — крадет с конца чужой.
+// fn(b, e, worker) получает номер исполнителя 0..size()-1 — индекс его
+// локального аккумулятора. parallelReduce дает каждому исполнителю свой
+// аккумулятор и сливает их в конце в порядке номеров.
+//
+// Задачи идут по одной (вызовы из разных потоков сериализуются);
+// вложенный вызов из исполнителя и пул из одного исполнителя проходят
+// те же куски последовательно в вызывающем потоке.
+// Блокирующие задачи (очереди производитель/потребитель, как в
+// pipeline.cpp) в пул не ставятся: у них свои потоки.
+
+// Кусок по умолчанию для проходов по парам/текстам: достаточно крупный,
+// чтобы накладные расходы очереди не были видны
+const size_t PARALLEL_GRAIN = (size_t)1 << 16;
+
+class ThreadPool {
+public:
+    static ThreadPool& instance() {
+        static ThreadPool pool(defaultSize());
+        return pool;
+    }
+
+    static unsigned defaultSize() {
+        if (const char* env = std::getenv("GFN_THREADS")) {
+            int n = std::atoi(env);
+            if (n > 0) return (unsigned)n;
+        }
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 4;
+    }
+
+    explicit ThreadPool(unsigned n) {
+        if (n == 0) n = 1;
+        for (unsigned i = 0; i < n; ++i) queues_.emplace_back(new Queue);
+        for (unsigned i = 1; i < n; ++i) threads_.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : threads_) t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return (unsigned)queues_.size(); }
+
+    // Номер исполнителя текущего потока или -1 вне пула
+    static int currentWorker() { return worker_(); }
+
+    void parallelFor(size_t begin, size_t end, size_t grain,
+                     const std::function<void(size_t, size_t, unsigned)>& fn) {
+        if (begin >= end) return;
+        if (grain == 0) grain = 1;
+        if (worker_() >= 0 || size() == 1 || end - begin <= grain) {
+            // Последовательно, но теми же кусками: прогресс, который fn
+            // отмечает раз на кусок, идет и с одним исполнителем
+            unsigned w = worker_() >= 0 ? (unsigned)worker_() : 0;
+            for (size_t b = begin; b < end; b = std::min(end, b + grain))
+                fn(b, std::min(end, b + grain), w);
+            return;
+        }
+        std::lock_guard<std::mutex> job(jobMutex_);
+        size_t chunks = (end - begin + grain - 1) / grain;
+        pending_.store(chunks, std::memory_order_relaxed);
+        fn_ = &fn;
+        // Непрерывные полосы кусков по очередям: соседние куски — у одного исполнителя
+        size_t per = (chunks + size() - 1) / size();
+        for (unsigned w = 0; w < size(); ++w) {
+            std::lock_guard<std::mutex> lk(queues_[w]->m);
+            for (size_t c = w * per; c < std::min(chunks, (w + 1) * per); ++c)
+                queues_[w]->q.emplace_back(begin + c * grain, std::min(end, begin + (c + 1) * grain));
+        }
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        worker_() = 0;
+        drain(0);
+        worker_() = -1;
+
+        std::unique_lock<std::mutex> lk(m_);
+        done_.wait(lk, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+        fn_ = nullptr;
+    }
+
+    template <typename T, typename Body, typename Combine>
+    T parallelReduce(size_t begin, size_t end, size_t grain, const T& identity, Body body,
+                     Combine combine) {
+        std::vector<T> local(size(), identity);
+        parallelFor(begin, end, grain,
+                    [&](size_t b, size_t e, unsigned w) { body(b, e, local[w]); });
+        T result = identity;
+        for (const T& l : local) combine(result, l);
+        return result;
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<std::pair<size_t, size_t>> q;
+    };
+
+    static int& worker_() {
+        static thread_local int id = -1;
+        return id;
+    }
+
+    bool take(unsigned id, std::pair<size_t, size_t>& r) {
+        {
+            std::lock_guard<std::mutex> lk(queues_[id]->m);
+            if (!queues_[id]->q.empty()) {
+                r = queues_[id]->q.front();
+                queues_[id]->q.pop_front();
+                return true;
+            }
+        }
+        for (unsigned k = 1; k < size(); ++k) {
+            Queue& v = *queues_[(id + k) % size()];
+            std::lock_guard<std::mutex> lk(v.m);
+            if (!v.q.empty()) {
+                r = v.q.back();
+                v.q.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void drain(unsigned id) {
+        std::pair<size_t, size_t> r;
+        while (take(id, r)) {
+            {
+                PROFILE_STAGE(chunk, "pool chunk");
+                (*fn_)(r.first, r.second, id);
+                PROFILE_STAGE_END(chunk, r.second - r.first);
+            }
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lk(m_);
+                done_.notify_all();
+            }
+        }
+    }
+
+    void workerLoop(unsigned id) {
+        worker_() = (int)id;
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lk(m_);
+                wake_.wait(lk, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            drain(id);
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    std::mutex jobMutex_;
+    std::mutex m_;
+    std::condition_variable wake_, done_;
+    std::atomic<size_t> pending_{0};
+    const std::function<void(size_t, size_t, unsigned)>* fn_ = nullptr;
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+};
+
+inline unsigned poolThreads() { return ThreadPool::instance().size(); }
+
+inline void parallelFor(size_t begin, size_t end, size_t grain,
+                        const std::function<void(size_t, size_t, unsigned)>& fn) {
+    ThreadPool::instance().parallelFor(begin, end, grain, fn);
+}
+
+template <typename T, typename Body, typename Combine>
+inline T parallelReduce(size_t begin, size_t end, size_t grain, const T& identity, Body body,
+                        Combine combine) {
+    return ThreadPool::instance().parallelReduce(begin, end, grain, identity, body, combine);
+}
+
+#endif // THREAD_POOL_H
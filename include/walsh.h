@@ -0,0 +1,212 @@
+#ifndef WALSH_H
+#define WALSH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "cipher_engine.h"
+#include "thread_pool.h"
+#include "progress.h"
+
+// --- ПРЕОБРАЗОВАНИЕ УОЛША-АДАМАРА (FWHT) ---
+//
+// Для выходной маски beta строится знаковая таблица по всему кодбуку
+//   f[x] = (-1)^{beta . E(x)},
+// и ее FWHT дает сразу все входные маски:
+//   W[alpha] = sum_x (-1)^{alpha . x  XOR  beta . E(x)} = 2^16 * corr(alpha, beta).
+// Смещение (как в linear_search): bias = W / 2^17.
+// На одну beta уходит 16 * 2^16 сложений, таблица 256 KiB живет в L2.
+//
+// Скан всех beta (walshScan) идет по упакованным битам: знаки f для
+// beta — XOR битовых плоскостей кодбука (бит j слова plane_j[x >> 6] —
+// бит j значения E[x]), и в порядке кода Грея соседние beta отличаются
+// одной плоскостью — 1024 XOR слов вместо 2^16 вычислений четности.
+// Первые 3 уровня FWHT берутся из таблицы по байту знаков, уровни до
+// 2^14 идут в int16 (|значение| <= 2^14 — вдвое больше элементов на
+// SIMD-регистр), последние два — с расширением до int32.
+
+const int WALSH_SIZE = 65536;
+
+// FWHT на месте, n — степень двойки
+template <typename T>
+inline void fwht(T* f, int n) {
+    for (int h = 1; h < n; h <<= 1) {
+        for (int i = 0; i < n; i += 2 * h) {
+            T* a = f + i;
+            T* b = f + i + h;
+            for (int j = 0; j < h; ++j) {
+                T u = a[j], v = b[j];
+                a[j] = u + v;
+                b[j] = u - v;
+            }
+        }
+    }
+}
+
+// Спектр Уолша по маске beta для перестановки E (все 2^16 alpha)
+inline void walshColumn(const uint16_t* E, uint16_t beta, int32_t* W) {
+    for (int x = 0; x < WALSH_SIZE; ++x) W[x] = 1 - 2 * (int32_t)parity(beta & E[x]);
+    fwht(W, WALSH_SIZE);
+}
+
+const int WALSH_WORDS = WALSH_SIZE / 64;
+
+// Битовые плоскости: planes[j * WALSH_WORDS + w], бит b — бит j E[64w + b]
+inline std::vector<uint64_t> walshPlanes(const uint16_t* E) {
+    std::vector<uint64_t> planes(16 * WALSH_WORDS, 0);
+    for (int x = 0; x < WALSH_SIZE; ++x)
+        for (int j = 0; j < 16; ++j)
+            planes[j * WALSH_WORDS + (x >> 6)] |= (uint64_t)((E[x] >> j) & 1) << (x & 63);
+    return planes;
+}
+
+// 8-точечное преобразование для байта знаков (бит 1 — значение -1)
+struct Walsh8Table {
+    int16_t t[256][8];
+    Walsh8Table() {
+        for (int b = 0; b < 256; ++b) {
+            int16_t f[8];
+            for (int i = 0; i < 8; ++i) f[i] = (int16_t)(1 - 2 * ((b >> i) & 1));
+            fwht(f, 8);
+            for (int i = 0; i < 8; ++i) t[b][i] = f[i];
+        }
+    }
+};
+
+inline const Walsh8Table& walsh8Table() {
+    static const Walsh8Table t;
+    return t;
+}
+
+// Спектр по упакованным знакам (бит x — parity(beta & E[x])); tmp — 2^16 int16
+inline void walshColumnPacked(const uint64_t* signs, int16_t* tmp, int32_t* W) {
+    const Walsh8Table& T8 = walsh8Table();
+    for (int w = 0; w < WALSH_WORDS; ++w) {
+        uint64_t v = signs[w];
+        for (int k = 0; k < 8; ++k)
+            memcpy(tmp + 64 * w + 8 * k, T8.t[(v >> (8 * k)) & 0xFF], sizeof(T8.t[0]));
+    }
+    for (int h = 8; h < WALSH_SIZE / 4; h <<= 1) {
+        for (int i = 0; i < WALSH_SIZE; i += 2 * h) {
+            int16_t* a = tmp + i;
+            int16_t* b = tmp + i + h;
+            for (int j = 0; j < h; ++j) {
+                int16_t u = a[j], v = b[j];
+                a[j] = (int16_t)(u + v);
+                b[j] = (int16_t)(u - v);
+            }
+        }
+    }
+    const int Q = WALSH_SIZE / 4;
+    for (int j = 0; j < Q; ++j) {
+        int32_t a = tmp[j], b = tmp[j + Q], c = tmp[j + 2 * Q], d = tmp[j + 3 * Q];
+        W[j] = a + b + c + d;
+        W[j + Q] = a - b + c - d;
+        W[j + 2 * Q] = a + b - c - d;
+        W[j + 3 * Q] = a - b - c + d;
+    }
+}
+
+struct LinearEntry {
+    uint16_t maskIn;
+    uint16_t maskOut;
+    int32_t walsh; // W(alpha, beta); bias = walsh / 2^17
+};
+
+// |walsh| по убыванию, затем (maskIn, maskOut) по возрастанию
+inline bool linearEntryBetter(const LinearEntry& a, const LinearEntry& b) {
+    int32_t wa = std::abs(a.walsh), wb = std::abs(b.walsh);
+    if (wa != wb) return wa > wb;
+    if (a.maskIn != b.maskIn) return a.maskIn < b.maskIn;
+    return a.maskOut < b.maskOut;
+}
+
+struct WalshScanResult {
+    std::vector<LinearEntry> top; // лучшие K, отсортированы
+    long long aboveThreshold = 0; // сколько пар масок с |walsh| > threshold
+};
+
+// Полный скан всех (alpha, beta != 0) для перестановки E.
+// Выходные маски раздаются в общем пуле (thread_pool.h) кусками по
+// WALSH_BETA_CHUNK номеров кода Грея, у каждого исполнителя свои буферы
+// и своя куча лучших K; кучи сливаются в конце. progress считает
+// выходные маски.
+const int WALSH_BETA_CHUNK = 256;
+
+struct WalshScratch {
+    std::vector<int32_t> W;
+    std::vector<int16_t> tmp;
+    std::vector<uint64_t> signs;
+    std::vector<LinearEntry> heap;
+    long long count = 0;
+};
+
+inline WalshScanResult walshScan(const uint16_t* E, int32_t threshold, size_t K,
+                                 ProgressMeter* progress = nullptr) {
+    const std::vector<uint64_t> planes = walshPlanes(E);
+    std::vector<WalshScratch> local(poolThreads());
+
+    parallelFor(0, WALSH_SIZE, WALSH_BETA_CHUNK, [&](size_t b, size_t e, unsigned tid) {
+        WalshScratch& sc = local[tid];
+        if (sc.W.empty()) {
+            sc.W.resize(WALSH_SIZE);
+            sc.tmp.resize(WALSH_SIZE);
+            sc.signs.resize(WALSH_WORDS);
+        }
+        std::vector<int32_t>& W = sc.W;
+        std::vector<uint64_t>& signs = sc.signs;
+        std::vector<LinearEntry>& heap = sc.heap;
+        long long cnt = 0;
+        for (int g0 = (int)b; g0 < (int)e; g0 += WALSH_BETA_CHUNK) {
+            // Знаки для первой beta куска — явно, дальше по одной плоскости
+            int beta = g0 ^ (g0 >> 1);
+            std::fill(signs.begin(), signs.end(), 0);
+            for (int j = 0; j < 16; ++j)
+                if ((beta >> j) & 1)
+                    for (int w = 0; w < WALSH_WORDS; ++w) signs[w] ^= planes[j * WALSH_WORDS + w];
+            for (int g = g0; g < g0 + WALSH_BETA_CHUNK; ++g) {
+                if (g != g0) {
+                    int j = __builtin_ctz(g);
+                    beta ^= 1 << j;
+                    const uint64_t* pl = &planes[j * WALSH_WORDS];
+                    for (int w = 0; w < WALSH_WORDS; ++w) signs[w] ^= pl[w];
+                }
+                if (beta == 0) continue;
+                walshColumnPacked(signs.data(), sc.tmp.data(), W.data());
+                for (int alpha = 1; alpha < WALSH_SIZE; ++alpha) {
+                    int32_t w = W[alpha];
+                    int32_t aw = std::abs(w);
+                    if (aw <= threshold) continue;
+                    ++cnt;
+                    if (heap.size() == K && aw < std::abs(heap.front().walsh)) continue;
+                    LinearEntry e{(uint16_t)alpha, (uint16_t)beta, w};
+                    if (heap.size() < K) {
+                        heap.push_back(e);
+                        std::push_heap(heap.begin(), heap.end(), linearEntryBetter);
+                    } else if (linearEntryBetter(e, heap.front())) {
+                        std::pop_heap(heap.begin(), heap.end(), linearEntryBetter);
+                        heap.back() = e;
+                        std::push_heap(heap.begin(), heap.end(), linearEntryBetter);
+                    }
+                }
+            }
+        }
+        sc.count += cnt;
+        if (progress) progress->add(e - b);
+    });
+
+    WalshScanResult r;
+    for (const WalshScratch& sc : local) {
+        r.top.insert(r.top.end(), sc.heap.begin(), sc.heap.end());
+        r.aboveThreshold += sc.count;
+    }
+    size_t k = std::min(K, r.top.size());
+    std::partial_sort(r.top.begin(), r.top.begin() + k, r.top.end(), linearEntryBetter);
+    r.top.resize(k);
+    return r;
+}
+
+#endif // WALSH_H
@@ -0,0 +1,327 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <functional>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "codebook.h"
+#include "counter_rng.h"
+#include "ddt_table.h"
+#include "last_round.h"
+#include "multi_round.h"
+#include "linear_key.h"
+#include "walsh.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+// Микробенчмарки горячих ядер и сравнение с сохраненной базой.
+// Использование:
+//   ./benchmark [--baseline=FILE] [--tolerance=0.25] [--out=FILE] [--min-time=SEC]
+//               [--only=NAME] [--cipher=FILE] [--master=HEX]
+// Каждое ядро повторяется, пока замер не займет --min-time, лучший из
+// BENCH_REPS замеров идет в bench_results.json (по строке на ядро).
+// С --baseline ядро медленнее базы больше чем на tolerance — регрессия,
+// код возврата 1. Пул по умолчанию в один поток (GFN_THREADS переопределяет):
+// скорости на ядро стабильнее между машинами и прогонами.
+
+const int BENCH_REPS = 3;
+const size_t BENCH_PAIRS = (size_t)1 << 20;
+const int BENCH_WALSH_COLUMNS = 8;
+const int BENCH_SEARCH_ROUNDS = 5; // analysis и linear_search работают с E_5
+
+struct BenchResult {
+    string name;
+    string unit;
+    double rate;
+};
+
+// Не дает компилятору выбросить результат ядра
+volatile uint64_t benchSink;
+
+// fn() выполняет work единиц; возвращает лучшую скорость, единиц/с
+double measure(double work, double minTime, const function<void()>& fn) {
+    fn(); // прогрев: кэши, ленивые таблицы
+    double best = 0;
+    for (int rep = 0; rep < BENCH_REPS; ++rep) {
+        long long calls = 0;
+        auto t0 = chrono::steady_clock::now();
+        double sec = 0;
+        do {
+            fn();
+            ++calls;
+            sec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        } while (sec < minTime);
+        best = max(best, calls * work / sec);
+    }
+    return best;
+}
+
+string cipherHashString(const CipherSpec& spec) {
+    char hash[32];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)spec.hash());
+    return hash;
+}
+
+// Строка "cipher": "<хэш>" и строки вида
+// {"name": "encrypt", "unit": "blocks/s", "rate": 1.2e+08}
+bool readBaseline(const string& path, string& cipher, vector<BenchResult>& out) {
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        size_t c = line.find("\"cipher\": \"");
+        if (c != string::npos) {
+            c += 11;
+            cipher = line.substr(c, line.find('"', c) - c);
+            continue;
+        }
+        size_t n = line.find("\"name\": \""), r = line.find("\"rate\": ");
+        if (n == string::npos || r == string::npos) continue;
+        n += 9;
+        BenchResult b;
+        b.name = line.substr(n, line.find('"', n) - n);
+        b.rate = atof(line.c_str() + r + 8);
+        out.push_back(b);
+    }
+    return true;
+}
+
+bool writeResults(const string& path, const vector<BenchResult>& results) {
+    ofstream out(path);
+    if (!out) return false;
+    out << "{\n  \"cipher\": \"" << cipherHashString(activeCipher()) << "\",\n  \"threads\": " << poolThreads()
+        << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        char rate[32];
+        snprintf(rate, sizeof(rate), "%.4g", results[i].rate);
+        out << "    {\"name\": \"" << results[i].name << "\", \"unit\": \"" << results[i].unit
+            << "\", \"rate\": " << rate << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+int main(int argc, char** argv) {
+    setenv("GFN_THREADS", "1", 0);
+    if (!parseCipherArgs(argc, argv)) return 1;
+
+    string baselinePath, outPath = "bench_results.json", only;
+    double tolerance = 0.25, minTime = 0.2;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--baseline=", 0) == 0) baselinePath = arg.substr(11);
+        else if (arg.rfind("--tolerance=", 0) == 0) tolerance = stod(arg.substr(12));
+        else if (arg.rfind("--out=", 0) == 0) outPath = arg.substr(6);
+        else if (arg.rfind("--min-time=", 0) == 0) minTime = stod(arg.substr(11));
+        else if (arg.rfind("--only=", 0) == 0) only = arg.substr(7);
+        else {
+            cerr << "Usage: " << argv[0] << " [--baseline=FILE] [--tolerance=T] [--out=FILE]"
+                 << " [--min-time=SEC] [--only=NAME] [--cipher=FILE] [--master=HEX]\n";
+            return 1;
+        }
+    }
+
+    const CipherSpec& spec = activeCipher();
+    Codebook CB;
+    if (!CB.build(spec)) return 1;
+
+    // Общие данные: N пар по целевой разности, как у генератора
+    const uint16_t dX = 0xA8C0, dY = 0x0002;
+    vector<uint16_t> X(BENCH_PAIRS), Y(BENCH_PAIRS), Yp(BENCH_PAIRS);
+    CounterRng(DEFAULT_DATA_SEED, RNG_STREAM_DIFF_PAIRS).fill16(0, BENCH_PAIRS, X.data());
+    for (size_t i = 0; i < BENCH_PAIRS; ++i) {
+        Y[i] = CB.enc(X[i]);
+        Yp[i] = CB.enc(X[i] ^ dX);
+    }
+    const double N = (double)BENCH_PAIRS;
+
+    vector<BenchResult> results;
+    auto bench = [&](const string& name, const string& unit, double work, const function<void()>& fn) {
+        if (!only.empty() && name != only) return;
+        double rate = measure(work, minTime, fn);
+        results.push_back({name, unit, rate});
+        printf("%-22s %12.4g %s\n", name.c_str(), rate, unit.c_str());
+        fflush(stdout);
+    };
+
+    cout << "Cipher " << hex << spec.hash() << dec << ", " << poolThreads() << " thread(s), "
+         << BENCH_PAIRS << " pairs" << endl;
+
+    // --- 1. Шифр ---
+    bench("encrypt", "blocks/s", 65536, [&] {
+        uint64_t acc = 0;
+        for (uint32_t x = 0; x < 65536; ++x) {
+            Block b = unpackBlock((uint16_t)x);
+            encrypt(b);
+            acc += packBlock(b);
+        }
+        benchSink = acc;
+    });
+    bench("encryptRounds", "blocks/s", 65536, [&] {
+        uint64_t acc = 0;
+        for (uint32_t x = 0; x < 65536; ++x) {
+            Block b = unpackBlock((uint16_t)x);
+            encryptRounds(b, 5);
+            acc += packBlock(b);
+        }
+        benchSink = acc;
+    });
+    bench("decryptOneRound", "blocks/s", 65536, [&] {
+        uint64_t acc = 0;
+        for (uint32_t x = 0; x < 65536; ++x) {
+            Block b = unpackBlock((uint16_t)x);
+            decryptOneRound(b, (uint8_t)(x & 0xF));
+            acc += packBlock(b);
+        }
+        benchSink = acc;
+    });
+    bench("spec_encrypt", "blocks/s", 65536, [&] {
+        uint64_t acc = 0;
+        for (uint32_t x = 0; x < 65536; ++x) acc += spec.encrypt((uint16_t)x);
+        benchSink = acc;
+    });
+    bench("spec_decrypt", "blocks/s", 65536, [&] {
+        uint64_t acc = 0;
+        for (uint32_t y = 0; y < 65536; ++y) {
+            uint16_t s = (uint16_t)y;
+            for (int r = spec.rounds - 1; r >= 0; --r) s = spec.unround(s, spec.roundKeys[r]);
+            acc += s;
+        }
+        benchSink = acc;
+    });
+    bench("codebook_build", "block-rounds/s", 65536.0 * spec.rounds, [&] {
+        Codebook cb;
+        cb.build(spec);
+        benchSink = cb.enc(1);
+    });
+    bench("parity", "words/s", N, [&] {
+        uint64_t acc = 0;
+        for (size_t i = 0; i < BENCH_PAIRS; ++i) acc += parity(Y[i] & Yp[i]);
+        benchSink = acc;
+    });
+
+    // --- 2. Переходы F (вероятности DDT, внутренний цикл trail_search) ---
+    DdtTables T;
+    buildDdtTables(T, spec);
+    {
+        long long perCall = 0;
+        for (int v = 0; v < 256; ++v) perCall += T.fNum[v];
+        bench("ddt_transitions", "transitions/s", (double)perCall * 256, [&] {
+            double acc = 0;
+            for (int s = 0; s < 256; ++s)
+                for (int v = 0; v < 256; ++v) {
+                    const FTransition* l = T.fList[v ^ s];
+                    for (int i = 0; i < T.fNum[v ^ s]; ++i) acc += l[i].prob * l[i].dF;
+                }
+            benchSink = (uint64_t)acc;
+        });
+    }
+
+    // --- 3. Данные и анализ ---
+    vector<uint16_t> gX(BENCH_PAIRS), gY(BENCH_PAIRS), gYp(BENCH_PAIRS);
+    bench("generate", "pairs/s", N, [&] {
+        const uint16_t* E = CB.encTable();
+        CounterRng(DEFAULT_DATA_SEED, RNG_STREAM_DIFF_PAIRS).fill16(0, BENCH_PAIRS, gX.data());
+        for (size_t i = 0; i < BENCH_PAIRS; ++i) {
+            gY[i] = E[gX[i]];
+            gYp[i] = E[gX[i] ^ dX];
+        }
+        benchSink = gY[BENCH_PAIRS - 1];
+    });
+    // Ядра на E_5 — только для спецификаций не короче 5 раундов (как в самих инструментах)
+    const bool searchRounds = spec.rounds >= BENCH_SEARCH_ROUNDS;
+    if (!searchRounds)
+        cout << "Skipping analysis and linear_search: cipher has only " << spec.rounds
+             << " rounds (need " << BENCH_SEARCH_ROUNDS << ")" << endl;
+    vector<uint32_t> hist(65536);
+    if (searchRounds) bench("analysis", "pairs/s", N, [&] {
+        const uint16_t* E5 = CB.encTable(BENCH_SEARCH_ROUNDS);
+        fill(hist.begin(), hist.end(), 0);
+        for (size_t i = 0; i < BENCH_PAIRS; ++i) hist[E5[X[i]] ^ E5[X[i] ^ dX]]++;
+        benchSink = hist[dY];
+    });
+
+    // --- 4. Атаки: кандидаты ключа x пары ---
+    bench("attack_last_round", "keys*pairs/s", 16 * N, [&] {
+        long long scores[16] = {0};
+        scoreLastRound(Y.data(), Yp.data(), BENCH_PAIRS, dY, scores);
+        benchSink = scores[3];
+    });
+    vector<long long> multiScores(256);
+    bench("attack_multi_round", "keys*pairs/s", 256 * N, [&] {
+        fill(multiScores.begin(), multiScores.end(), 0);
+        scoreMultiRound(Y.data(), Yp.data(), BENCH_PAIRS, dY, 2, multiScores.data());
+        benchSink = multiScores[0];
+    });
+    bench("attack_linear", "keys*pairs/s", 16 * N, [&] {
+        LinearCountTable t;
+        linearCountPairs(X.data(), Y.data(), BENCH_PAIRS, LINEAR_TARGET_MASK_IN, LINEAR_TARGET_MASK_OUT, t);
+        long long matches[16];
+        linearScoreKeys(t, LINEAR_TARGET_MASK_OUT, matches);
+        benchSink = matches[0];
+    });
+
+    // --- 5. linear_search: столбец спектра — 2^16 alpha на 2^16 текстов ---
+    const vector<uint64_t> planes = searchRounds ? walshPlanes(CB.encTable(BENCH_SEARCH_ROUNDS))
+                                                 : vector<uint64_t>();
+    vector<uint64_t> signs(WALSH_WORDS);
+    vector<int16_t> tmp(WALSH_SIZE);
+    vector<int32_t> W(WALSH_SIZE);
+    if (searchRounds) bench("linear_search", "masks^2*samples/s", (double)BENCH_WALSH_COLUMNS * WALSH_SIZE * WALSH_SIZE, [&] {
+        uint64_t acc = 0;
+        for (int c = 1; c <= BENCH_WALSH_COLUMNS; ++c) {
+            for (int w = 0; w < WALSH_WORDS; ++w) signs[w] = planes[w] ^ planes[(c % 16) * WALSH_WORDS + w];
+            walshColumnPacked(signs.data(), tmp.data(), W.data());
+            acc += W[c];
+        }
+        benchSink = acc;
+    });
+
+    if (!writeResults(outPath, results)) {
+        cerr << "Error: cannot write " << outPath << "\n";
+        return 1;
+    }
+    cout << "Results saved to " << outPath << endl;
+
+    if (baselinePath.empty()) return 0;
+    vector<BenchResult> base;
+    string baseCipher;
+    if (!readBaseline(baselinePath, baseCipher, base)) {
+        cerr << "Error: cannot read baseline " << baselinePath << "\n";
+        return 1;
+    }
+    // Скорости другой спецификации (--cipher / --master) с базой не сравнимы
+    if (baseCipher != cipherHashString(spec)) {
+        cerr << "Error: baseline " << baselinePath << " was recorded for cipher "
+             << (baseCipher.empty() ? "<unknown>" : baseCipher) << ", this run uses "
+             << cipherHashString(spec) << "; record a baseline with --out for this cipher.\n";
+        return 1;
+    }
+    cout << "\n--- Compared to " << baselinePath << " (tolerance " << tolerance * 100 << "%) ---\n";
+    int regressions = 0;
+    for (const auto& r : results) {
+        const BenchResult* b = nullptr;
+        for (const auto& x : base)
+            if (x.name == r.name) b = &x;
+        if (!b || b->rate <= 0) {
+            printf("%-22s %12s\n", r.name.c_str(), "no baseline");
+            continue;
+        }
+        double ratio = r.rate / b->rate;
+        const char* verdict = ratio < 1 - tolerance ? "REGRESSION" : ratio > 1 + tolerance ? "faster" : "ok";
+        regressions += ratio < 1 - tolerance;
+        printf("%-22s %+8.1f%%  %s\n", r.name.c_str(), (ratio - 1) * 100, verdict);
+    }
+    if (regressions) {
+        cout << regressions << " kernel(s) slower than baseline" << endl;
+        return 1;
+    }
+    cout << "No regressions" << endl;
+    return 0;
+}
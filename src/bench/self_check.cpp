@@ -0,0 +1,51 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "bitslice.h"
+
+using namespace std;
+
+// Сверка битслайс-движка со скалярным CipherSpec::encrypt (make check).
+// Использование:
+//   ./self_check [--cipher=FILE] [--master=HEX]
+// Проверяются все ширины пакета (64/256/512) на всех 2^16 блоках для
+// r = 1..rounds, а также хвост encryptBlocks. Кроме активной спецификации
+// проверяется производная: обратный S-Box (схема из ANF, а не константная)
+// и MAX_ROUNDS раундов. Код возврата 1 при расхождении.
+
+const size_t CHECK_TAIL_BLOCKS = 1000; // не кратно ни одной ширине пакета
+
+static bool checkSpec(const char* name, const CipherSpec& spec) {
+    bool ok = bitsliceSelfCheck(spec);
+
+    uint16_t in[CHECK_TAIL_BLOCKS], out[CHECK_TAIL_BLOCKS];
+    for (size_t i = 0; i < CHECK_TAIL_BLOCKS; ++i) in[i] = (uint16_t)(i * 0x9E37u);
+    encryptBlocks(in, out, CHECK_TAIL_BLOCKS, spec);
+    for (size_t i = 0; i < CHECK_TAIL_BLOCKS && ok; ++i)
+        if (out[i] != spec.encrypt(in[i])) ok = false;
+
+    printf("%-10s rounds=%-2d %s\n", name, spec.rounds, ok ? "OK" : "FAIL");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    if (!parseCipherArgsOnly(argc, argv)) return 1;
+    const CipherSpec& spec = activeCipher();
+
+    CipherSpec derived = spec;
+    for (int x = 0; x < 16; ++x) derived.sbox[spec.sbox[x] & 0xF] = (uint8_t)x;
+    derived.rounds = MAX_ROUNDS;
+    for (int r = spec.rounds; r < MAX_ROUNDS; ++r)
+        derived.roundKeys[r] = derived.roundKeys[r % spec.rounds];
+
+    bool ok = checkSpec("active", spec);
+    if (spec.isPermutation()) ok = checkSpec("inverse", derived) && ok;
+
+    if (!ok) {
+        cerr << "Error: bitsliced engine does not match CipherSpec::encrypt().\n";
+        return 1;
+    }
+    return 0;
+}
@@ -1,29 +1,32 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <thread>
-#include <map>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include <algorithm>
 #include <iomanip>
-#include <atomic>
 #include "cipher_engine.h"
+#include "codebook.h"
+#include "pair_io.h"
+#include "thread_pool.h"
+#include "progress.h"
+#include "instrument.h"
 
 using namespace std;
 
-const int NUM_THREADS = 16;
 const int ANALYSIS_ROUNDS = 5; // We look for characteristics after 5 rounds
+const int TOP_K = 200;          // Differentials written to diff_round_5_top.txt
 
-struct PairData {
-    Block X;
-    Block dX;
-    // Y and Yp are not strictly needed for the analysis phase if we re-encrypt, 
-    // but the generator provides them. We only need X and dX to simulate 5 rounds.
-};
+// Flat histograms: one 65536-counter row per active dX, indexed by packed dY.
+// Each pool worker gets its own table; above this budget fewer tables are
+// used (one per data band), and if even one table does not fit, counting
+// falls back to sorting packed (dX, dY) keys.
+const int HIST_SIZE = 65536;
+const size_t HIST_BUDGET_BYTES = size_t(1) << 30;
 
-// Helper to pack 4 nibbles into a 16-bit integer for map keys
-uint16_t pack(const Block& b) {
-    return (b.x[0] << 12) | (b.x[1] << 8) | (b.x[2] << 4) | b.x[3];
-}
+// Full codebook: 5-round encryption is a single table load
+Codebook CB;
 
 // Helper to unpack for printing
 Block unpack(uint16_t val) {
@@ -36,167 +39,257 @@ Block unpack(uint16_t val) {
 }
 
 // --- Loading Data ---
-vector<PairData> loadPairs(const string& filename) {
-    ifstream fin(filename);
-    vector<PairData> data;
-    if (!fin.is_open()) return data;
-
-    int vals[16];
-    while (fin >> vals[0]) {
-        for (int i = 1; i < 16; ++i) fin >> vals[i];
-        
-        PairData p;
-        // X: 0-3
-        p.X.x[0] = vals[0]; p.X.x[1] = vals[1]; p.X.x[2] = vals[2]; p.X.x[3] = vals[3];
-        // dX: 4-7
-        p.dX.x[0] = vals[4]; p.dX.x[1] = vals[5]; p.dX.x[2] = vals[6]; p.dX.x[3] = vals[7];
-        
-        // We ignore Y and Yp (indexes 8-15) for the analysis simulation phase
-        // because we need to encrypt X and X^dX for exactly 5 rounds, 
-        // whereas the file contains full 6-round encryption.
+// pairs_data.bin is mapped read-only; only the X and dX columns are used here.
+// Y and Yp hold the full 6-round encryption, whereas we need exactly 5 rounds.
+bool loadPairs(const string& filename, PairFile& pairs) {
+    if (!pairs.open(filename)) return false;
+    if (!pairs.matchesSchedule())
+        cerr << "Warning: " << filename << " was generated with a different key schedule.\n";
+    return true;
+}
 
-        data.push_back(p);
+// --- Analysis ---
+
+// Cache-line aligned counter arrays
+struct AlignedFree {
+    void operator()(uint32_t* p) const { free(p); }
+};
+typedef unique_ptr<uint32_t[], AlignedFree> CountArray;
+
+CountArray allocCounts(size_t n) {
+    size_t bytes = (n * sizeof(uint32_t) + 63) / 64 * 64;
+    uint32_t* p = (uint32_t*)aligned_alloc(64, bytes);
+    if (!p) {
+        cerr << "Error: cannot allocate " << bytes << " bytes for histograms.\n";
+        exit(1);
     }
-    return data;
+    memset(p, 0, bytes);
+    PROFILE_COUNT("alloc bytes", bytes);
+    return CountArray(p);
 }
 
-// --- Analysis ---
-// Map: InputDiff (16bit) -> OutputDiff (16bit) -> Count
-typedef map<uint16_t, map<uint16_t, long long>> DiffMap;
+// Histogram mode: hist[idx * HIST_SIZE + dY], idx = dense index of the dX
+void diffWorker(const PairFile& data, int start, int end,
+                const vector<int32_t>& dxIndex, uint32_t* hist)
+{
+    const uint16_t* E5 = CB.encTable(ANALYSIS_ROUNDS);
+    const uint16_t* X = data.X();
+    const uint16_t* dX = data.dX();
+
+    for (int i = start; i < end; ++i) {
+        // 1. X and X' = X ^ dX, encrypted for 5 rounds via the codebook
+        uint16_t dX_packed = dX[i];
+        uint16_t x = X[i];
+
+        // 2. Output Difference dY
+        uint16_t dY_packed = E5[x] ^ E5[x ^ dX_packed];
+
+        hist[(size_t)dxIndex[dX_packed] * HIST_SIZE + dY_packed]++;
+    }
+}
 
-void diffWorker(const vector<PairData>& data, int start, int end,
-                DiffMap& localFreq, map<uint16_t, long long>& localTotal,
-                atomic<int>& processed, int total_n) 
+// Key-sort mode (too many distinct dX for flat tables): keys[i] = dX << 16 | dY
+void keyWorker(const PairFile& data, int start, int end,
+               uint32_t* keys)
 {
+    const uint16_t* E5 = CB.encTable(ANALYSIS_ROUNDS);
+    const uint16_t* X = data.X();
+    const uint16_t* dX = data.dX();
+
     for (int i = start; i < end; ++i) {
-        const PairData& p = data[i];
-
-        // 1. Encrypt X for 5 rounds
-        Block out1 = p.X;
-        encryptRounds(out1, ANALYSIS_ROUNDS);
-
-        // 2. Encrypt X' = X ^ dX for 5 rounds
-        Block out2 = p.X;
-        out2.x[0] ^= p.dX.x[0];
-        out2.x[1] ^= p.dX.x[1];
-        out2.x[2] ^= p.dX.x[2];
-        out2.x[3] ^= p.dX.x[3];
-        encryptRounds(out2, ANALYSIS_ROUNDS);
-
-        // 3. Calculate Output Difference dY
-        Block dY;
-        dY.x[0] = out1.x[0] ^ out2.x[0];
-        dY.x[1] = out1.x[1] ^ out2.x[1];
-        dY.x[2] = out1.x[2] ^ out2.x[2];
-        dY.x[3] = out1.x[3] ^ out2.x[3];
-
-        uint16_t dX_packed = pack(p.dX);
-        uint16_t dY_packed = pack(dY);
-
-        localFreq[dX_packed][dY_packed]++;
-        localTotal[dX_packed]++;
-
-        // Progress update
-        int done = ++processed;
-        if (done % 500000 == 0 && start == 0) { // approximate check
-             // Printing from worker logic is messy, handled loosely here or better in main
-        }
+        uint16_t dX_packed = dX[i];
+        uint16_t x = X[i];
+        uint16_t dY_packed = E5[x] ^ E5[x ^ dX_packed];
+        keys[i] = ((uint32_t)dX_packed << 16) | dY_packed;
     }
 }
 
-int main() {
-    cout << "Loading data..." << endl;
-    vector<PairData> data = loadPairs("pairs_data.txt");
-    if (data.empty()) {
-        cerr << "No data loaded from pairs_data.txt. Run generator first.\n";
-        return 1;
+// Sum the per-thread tables into hist[0]; each reducer owns a slice
+void reduceWorker(vector<CountArray>& hist, size_t begin, size_t end) {
+    uint32_t* dst = hist[0].get();
+    for (size_t t = 1; t < hist.size(); ++t) {
+        const uint32_t* src = hist[t].get();
+        for (size_t j = begin; j < end; ++j) dst[j] += src[j];
     }
+}
 
-    int n = (int)data.size();
-    cout << "Loaded " << n << " pairs." << endl;
+struct TopDiff {
+    double p;
+    long long count;
+    uint16_t dX;
+    uint16_t dY;
+};
 
-    int perThread = (n + NUM_THREADS - 1) / NUM_THREADS;
-    atomic<int> processed(0);
+// Probability descending; ties by (dX, dY) ascending so the output is deterministic
+bool topDiffBetter(const TopDiff& a, const TopDiff& b) {
+    if (a.p != b.p) return a.p > b.p;
+    if (a.dX != b.dX) return a.dX < b.dX;
+    return a.dY < b.dY;
+}
 
-    vector<DiffMap> localFreq(NUM_THREADS);
-    vector<map<uint16_t, long long>> localTotal(NUM_THREADS);
-    vector<thread> threads;
+// Bounded heap keeping the K best entries (front = worst kept)
+struct TopKSelector {
+    size_t K;
+    vector<TopDiff> heap;
+
+    explicit TopKSelector(size_t k) : K(k) {}
+
+    void offer(const TopDiff& e) {
+        if (heap.size() < K) {
+            heap.push_back(e);
+            push_heap(heap.begin(), heap.end(), topDiffBetter);
+        } else if (topDiffBetter(e, heap.front())) {
+            pop_heap(heap.begin(), heap.end(), topDiffBetter);
+            heap.back() = e;
+            push_heap(heap.begin(), heap.end(), topDiffBetter);
+        }
+    }
 
-    cout << "Starting analysis on " << NUM_THREADS << " threads..." << endl;
+    vector<TopDiff> sorted() const {
+        vector<TopDiff> out = heap;
+        sort(out.begin(), out.end(), topDiffBetter);
+        return out;
+    }
+};
 
-    for (int t = 0; t < NUM_THREADS; ++t) {
-        int s = t * perThread;
-        int e = min(n, (t + 1) * perThread);
-        if (s >= e) break;
-        threads.emplace_back(diffWorker, ref(data), s, e, 
-                             ref(localFreq[t]), ref(localTotal[t]), 
-                             ref(processed), n);
+int main(int argc, char** argv) {
+    if (!parseCipherArgsOnly(argc, argv)) return 1;
+    if (activeCipher().rounds < ANALYSIS_ROUNDS) {
+        cerr << "Error: analysis needs at least " << ANALYSIS_ROUNDS << " rounds\n";
+        return 1;
     }
+    if (!CB.open()) return 1;
 
-    // Monitor progress
-    while(processed < n) {
-        int d = processed.load();
-        double pct = 100.0 * d / n;
-        cout << "\rProgress: " << fixed << setprecision(1) << pct << "%" << flush;
-        this_thread::sleep_for(chrono::seconds(1));
+    cout << "Loading data..." << endl;
+    PROFILE_STAGE(load, "load");
+    PairFile data;
+    if (!loadPairs("pairs_data.bin", data) || data.count() == 0) {
+        cerr << "No data loaded from pairs_data.bin. Run generator first.\n";
+        return 1;
     }
-    cout << endl;
 
-    for (auto& th : threads) th.join();
+    int n = (int)data.count();
+    PROFILE_STAGE_END(load, n);
+    cout << "Loaded " << n << " pairs." << endl;
+
+    // Active input differences and their pair totals
+    PROFILE_STAGE(index, "index dX");
+    vector<int32_t> dxIndex(HIST_SIZE, -1);
+    vector<uint16_t> activeDx;
+    vector<long long> dxTotal;
+    for (int i = 0; i < n; ++i) {
+        uint16_t dX = data.dX()[i];
+        if (dxIndex[dX] < 0) {
+            dxIndex[dX] = (int32_t)activeDx.size();
+            activeDx.push_back(dX);
+            dxTotal.push_back(0);
+        }
+        dxTotal[dxIndex[dX]]++;
+    }
+    PROFILE_STAGE_END(index, n);
+
+    size_t tableCounters = activeDx.size() * HIST_SIZE;
+    size_t tableBytes = tableCounters * sizeof(uint32_t);
+    bool histMode = tableBytes <= HIST_BUDGET_BYTES;
+    int numThreads = (int)poolThreads();
+    int numTables = numThreads;
+    if (histMode) numTables = (int)max<size_t>(1, min<size_t>(numThreads, HIST_BUDGET_BYTES / tableBytes));
+
+    // Enough tables: one per pool worker, small chunks stolen freely.
+    // Otherwise the data is cut into numTables bands, one table per band.
+    bool perWorker = numTables == numThreads;
+    size_t grain = perWorker ? PARALLEL_GRAIN : ((size_t)n + numTables - 1) / numTables;
+
+    vector<CountArray> hist;
+    vector<uint32_t> keys;
+    if (histMode) {
+        for (int t = 0; t < numTables; ++t) hist.push_back(allocCounts(tableCounters));
+    } else {
+        keys.resize(n);
+    }
+
+    cout << "Starting analysis on " << numThreads << " threads ("
+         << activeDx.size() << " input differences, "
+         << (histMode ? "flat histograms" : "key sort") << ")..." << endl;
+
+    // Progress: one counter update per PARALLEL_GRAIN pairs, not per pair
+    ProgressMeter progress("Analysis", n);
+    PROFILE_STAGE(count, "count");
+    parallelFor(0, n, grain, [&](size_t s, size_t e, unsigned tid) {
+        uint32_t* table = histMode ? hist[perWorker ? tid : s / grain].get() : nullptr;
+        for (size_t b = s; b < e; b += PARALLEL_GRAIN) {
+            int end = (int)min(e, b + PARALLEL_GRAIN);
+            if (histMode) diffWorker(data, (int)b, end, dxIndex, table);
+            else keyWorker(data, (int)b, end, keys.data());
+            progress.add(end - b);
+        }
+    });
+    PROFILE_STAGE_END(count, n);
+    PROFILE_COUNT("pairs processed", n);
+    progress.finish();
 
     cout << "Merging results..." << endl;
 
-    // Merge results
-    DiffMap globalFreq;
-    map<uint16_t, long long> globalTotal;
-    for (int t = 0; t < NUM_THREADS; ++t) {
-        for (auto& kv : localTotal[t]) globalTotal[kv.first] += kv.second;
-        for (auto& dx : localFreq[t]) {
-            auto& gdx = globalFreq[dx.first];
-            for (auto& dy : dx.second) gdx[dy.first] += dy.second;
+    TopKSelector top(TOP_K);
+    if (histMode) {
+        // Parallel reduction over slices of the flat tables
+        PROFILE_STAGE(merge, "merge");
+        parallelFor(0, tableCounters, PARALLEL_GRAIN,
+                    [&](size_t s, size_t e, unsigned) { reduceWorker(hist, s, e); });
+        PROFILE_STAGE_END(merge, tableCounters * numTables);
+
+        PROFILE_SCOPE("top-k");
+
+        const uint32_t* global = hist[0].get();
+        for (size_t idx = 0; idx < activeDx.size(); ++idx) {
+            long long total = dxTotal[idx];
+            const uint32_t* row = global + idx * HIST_SIZE;
+            for (int dY = 0; dY < HIST_SIZE; ++dY) {
+                if (row[dY] == 0) continue;
+                top.offer({(double)row[dY] / total, row[dY], activeDx[idx], (uint16_t)dY});
+            }
+        }
+    } else {
+        PROFILE_STAGE(sort, "sort");
+        sort(keys.begin(), keys.end());
+        PROFILE_STAGE_END(sort, keys.size());
+
+        PROFILE_SCOPE("top-k");
+        for (size_t i = 0; i < keys.size();) {
+            size_t j = i;
+            while (j < keys.size() && keys[j] == keys[i]) ++j;
+            uint16_t dX = keys[i] >> 16;
+            long long count = (long long)(j - i);
+            top.offer({(double)count / dxTotal[dxIndex[dX]], count, dX, (uint16_t)(keys[i] & 0xFFFF)});
+            i = j;
         }
     }
 
     cout << "Writing top differentials..." << endl;
 
     // --- Output Global Top ---
+    PROFILE_STAGE(write, "write");
     ofstream fout("diff_round_5_top.txt");
-    vector< tuple<double, long long, uint16_t, uint16_t> > all_diffs; // prob, count, dX, dY
-
-    for (auto& dx_pair : globalFreq) {
-        uint16_t dX_val = dx_pair.first;
-        long long total = globalTotal[dX_val];
-        if (total == 0) continue;
-
-        for (auto& dy_pair : dx_pair.second) {
-            uint16_t dY_val = dy_pair.first;
-            long long count = dy_pair.second;
-            double p = (double)count / total;
-            all_diffs.emplace_back(p, count, dX_val, dY_val);
-        }
-    }
-
-    // Sort by probability descending
-    sort(all_diffs.begin(), all_diffs.end(),
-        [](auto& a, auto& b) { return get<0>(a) > get<0>(b); });
+    vector<TopDiff> best = top.sorted();
 
     fout << fixed << setprecision(6);
     fout << "Top Differentials after " << ANALYSIS_ROUNDS << " rounds (Variant 5):\n\n";
     
-    for (int i = 0; i < 200 && i < (int)all_diffs.size(); ++i) {
-        auto& e = all_diffs[i];
-        Block dX = unpack(get<2>(e));
-        Block dY = unpack(get<3>(e));
+    for (int i = 0; i < (int)best.size(); ++i) {
+        const TopDiff& e = best[i];
+        Block dX = unpack(e.dX);
+        Block dY = unpack(e.dY);
         
         fout << i + 1 << ") dX=(" 
              << (int)dX.x[0] << "," << (int)dX.x[1] << "," << (int)dX.x[2] << "," << (int)dX.x[3] << ") "
              << "-> dY=(" 
              << (int)dY.x[0] << "," << (int)dY.x[1] << "," << (int)dY.x[2] << "," << (int)dY.x[3] << ") "
-             << " count=" << get<1>(e)
-             << " p=" << get<0>(e) << "\n";
+             << " count=" << e.count
+             << " p=" << e.p << "\n";
     }
     fout.close();
+    PROFILE_STAGE_END(write, best.size());
     cout << "Saved to diff_round_5_top.txt" << endl;
 
     return 0;
-}
\ No newline at end of file
+}
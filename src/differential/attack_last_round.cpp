@@ -1,22 +1,35 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <thread>
 #include <atomic>
 #include <algorithm>
 #include <iomanip>
+#include <string>
 #include "cipher_engine.h"
+#include "pair_io.h"
+#include "last_round.h"
+#include "multi_diff.h"
+#include "instrument.h"
 
 using namespace std;
 
+// Использование:
+//   ./attack                        одна цель — первая строка trail_results.txt
+//   ./attack --multi[=K]            первые K дифференциалов файла (по умолчанию все),
+//                                   счет — LLR (include/multi_diff.h)
+//   ./attack --truncated=PATTERN    усеченный дифференциал, например 000*
+//   [--trail=FILE]                  файл траекторий (./trail_search --top=N)
+
 // Целевые характеристики (загружаются из файла)
 int T_dX[4] = {0};
 int T_dY[4] = {0};
 
+string TRAIL_FILE = "trail_results.txt";
+
 void load_trail_targets() {
-    ifstream in("trail_results.txt");
+    ifstream in(TRAIL_FILE);
     if (!in.is_open()) {
-        cerr << "Error: trail_results.txt not found.\n";
+        cerr << "Error: " << TRAIL_FILE << " not found.\n";
         exit(1);
     }
     // Читаем: in0 in1 in2 in3 out0 out1 out2 out3
@@ -29,65 +42,106 @@ void load_trail_targets() {
     cout << "  dY: " << T_dY[0] << " " << T_dY[1] << " " << T_dY[2] << " " << T_dY[3] << endl;
 }
 
-struct PairData {
-    Block Y;
-    Block Yp;
-};
-
-// Загрузка данных (теперь без фильтрации, т.к. генератор уже отфильтровал)
-vector<PairData> loadPairs(const string& filename) {
-    ifstream fin(filename);
-    vector<PairData> data;
-    if (!fin.is_open()) return data;
-
-    int vals[16];
-    // Формат: X(4) dX(4) Y(4) Yp(4)
-    while (fin >> vals[0]) {
-        for (int i = 1; i < 16; ++i) fin >> vals[i];
-        
-        PairData p;
-        p.Y.x[0] = vals[8]; p.Y.x[1] = vals[9]; p.Y.x[2] = vals[10]; p.Y.x[3] = vals[11];
-        p.Yp.x[0] = vals[12]; p.Yp.x[1] = vals[13]; p.Yp.x[2] = vals[14]; p.Yp.x[3] = vals[15];
-        data.push_back(p);
+// Все записи файла траекторий (не больше limit), у которых dX есть в данных
+vector<MultiDiffTarget> load_multi_targets(const PairFile& pf, int limit) {
+    vector<uint8_t> present(65536, 0);
+    const uint16_t* dX = pf.dX();
+    for (size_t i = 0; i < pf.count(); ++i) present[dX[i]] = 1;
+
+    vector<MultiDiffTarget> list;
+    ifstream in(TRAIL_FILE);
+    int x[4], y[4];
+    double p;
+    while ((limit <= 0 || (int)list.size() < limit) &&
+           in >> x[0] >> x[1] >> x[2] >> x[3] >> y[0] >> y[1] >> y[2] >> y[3] >> p) {
+        uint16_t px = packNibbles(x);
+        if (present[px] && p > 0) list.push_back({px, packNibbles(y), p});
     }
-    return data;
+    return list;
 }
 
-int main() {
-    load_trail_targets();
-
-    vector<PairData> data = loadPairs("pairs_data.txt");
-    if (data.empty()) {
-        cerr << "No pairs data found.\n";
+// Множественный / усеченный режим: LLR по всем целям за один проход
+int run_multi(const PairFile& pf, int limit, const string& pattern) {
+    PROFILE_STAGE(model, "build model");
+    vector<MultiDiffTarget> list = load_multi_targets(pf, limit);
+    MultiDiffModel model;
+    model.build(list, pattern);
+    PROFILE_STAGE_END(model, list.size());
+    if (model.rows() == 0) {
+        cerr << "Error: no targets in " << TRAIL_FILE << " match the data"
+             << (pattern.empty() ? "" : " and pattern " + pattern) << ".\n";
         return 1;
     }
-    cout << "Loaded " << data.size() << " pairs for attack.\n";
+    cout << (pattern.empty() ? "Multiple differential: " : "Truncated differential " + pattern + ": ")
+         << list.size() << " trail entries, " << model.dXs.size() << " dX\n";
+    for (size_t d = 0; d < model.dXs.size(); ++d)
+        cout << "  dX=" << hex << setw(4) << setfill('0') << model.dXs[d] << dec << setfill(' ')
+             << "  targets=" << model.targets[d] << "  P=" << model.mass[d] << "\n";
 
-    vector<long long> key_scores(16, 0);
+    vector<uint32_t> cnt = countMultiDiffParallel(model, pf.dX(), pf.Y(), pf.Yp(), pf.count());
+    double llr[16];
+    long long hits[16];
+    scoreMultiDiff(model, cnt, llr, hits);
+
+    vector<int> order(16);
+    for (int k = 0; k < 16; ++k) order[k] = k;
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return llr[a] > llr[b]; });
+
+    ofstream fout("last_round_key_guess.txt");
+    cout << "\n--- Attack Results (LLR) ---\n";
+    for (int k : order) {
+        cout << "Key = " << k << " (0x" << hex << k << dec << ") | LLR: " << fixed << setprecision(2)
+             << llr[k] << defaultfloat << " | Hits: " << hits[k] << endl;
+        fout << "Key=" << k << " Hits=" << hits[k] << " LLR=" << llr[k] << "\n";
+    }
+    fout.close();
+    return 0;
+}
 
-    // Атака на ключ 6-го раунда
-    for (int k = 0; k < 16; ++k) {
-        uint8_t key_guess = (uint8_t)k;
-        
-        for (const auto& p : data) {
-            Block Z = p.Y;
-            decryptOneRound(Z, key_guess);
-
-            Block Zp = p.Yp;
-            decryptOneRound(Zp, key_guess);
-
-            // Проверка на совпадение с TARGET_dY
-            bool match = true;
-            for(int i=0; i<4; ++i) {
-                int diff = Z.x[i] ^ Zp.x[i];
-                if (diff != T_dY[i]) {
-                    match = false;
-                    break;
-                }
+int main(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return 1;
+    bool multi = false;
+    int limit = 0;
+    string pattern;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--multi") multi = true;
+        else if (arg.rfind("--multi=", 0) == 0) {
+            multi = true;
+            limit = stoi(arg.substr(8));
+        } else if (arg.rfind("--truncated=", 0) == 0) {
+            multi = true;
+            pattern = arg.substr(12);
+            if (!validTruncatedPattern(pattern)) {
+                cerr << "Error: pattern must be 4 nibbles of 0-f, '*' (nonzero) or '?' (any)\n";
+                return 1;
             }
-            if (match) key_scores[k]++;
+        } else if (arg.rfind("--trail=", 0) == 0) TRAIL_FILE = arg.substr(8);
+        else {
+            cerr << "Usage: " << argv[0] << " [--multi[=K] | --truncated=PATTERN] [--trail=FILE]"
+                 << " [--cipher=FILE] [--master=HEX]\n";
+            return 1;
         }
     }
+    load_trail_targets();
+
+    // Колонки Y, Yp читаются прямо из отображенного pairs_data.bin
+    // (без фильтрации, т.к. генератор уже отфильтровал)
+    PairFile pf;
+    if (!pf.open("pairs_data.bin") || pf.count() == 0) {
+        cerr << "No pairs data found.\n";
+        return 1;
+    }
+    if (!pf.matchesSchedule())
+        cerr << "Warning: pairs_data.bin was generated with a different key schedule.\n";
+    cout << "Loaded " << pf.count() << " pairs for attack.\n";
+
+    if (multi) return run_multi(pf, limit, pattern);
+
+    // Атака на ключ 6-го раунда: один проход по данным, все 16 ключей сразу
+    const uint16_t dY = (uint16_t)((T_dY[0] << 12) | (T_dY[1] << 8) | (T_dY[2] << 4) | T_dY[3]);
+    vector<long long> key_scores(16, 0);
+    scoreLastRoundParallel(pf.Y(), pf.Yp(), pf.count(), dY, key_scores.data());
 
     // Вывод
     ofstream fout("last_round_key_guess.txt");
@@ -0,0 +1,180 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iomanip>
+#include <cmath>
+#include "cipher_engine.h"
+#include "codebook.h"
+#include "pair_io.h"
+#include "multi_round.h"
+#include "counter_rng.h"
+#include "thread_pool.h"
+#include "instrument.h"
+
+using namespace std;
+
+// Восстановление всего мастер-ключа (t1..t4) за один запуск.
+//  1. Дифференциал на R - L раундов (первая строка файла
+//     траекторий, например ./trail_search --rounds=4 --out=trail_results_4r.txt).
+//  2. Пары с выбранными открытыми текстами шифруются оракулом (кодбук).
+//  3. Ключи последних L раундов перебираются совместно, с ранним отказом
+//     (include/multi_round.h), на всех ядрах.
+//  4. Кандидаты проверяются по убыванию счета: оставшиеся нибблы мастер-
+//     ключа добираются перебором и сверяются с известными парами (X, E(X)).
+//
+// Использование:
+//   ./attack_multi [--peel=2] [--trail=trail_results_4r.txt] [--factor=8]
+//                  [--cipher=FILE] [--master=HEX]
+
+const int VERIFY_PAIRS = 4;
+
+int main(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return 1;
+    const CipherSpec& spec = activeCipher();
+
+    int peel = 2;
+    string trailName;
+    double factor = 8.0;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--peel=", 0) == 0) peel = stoi(arg.substr(7));
+        else if (arg.rfind("--trail=", 0) == 0) trailName = arg.substr(8);
+        else if (arg.rfind("--factor=", 0) == 0) factor = stod(arg.substr(9));
+        else {
+            cerr << "Usage: " << argv[0] << " [--peel=L] [--trail=FILE] [--factor=C]"
+                 << " [--cipher=FILE] [--master=HEX]\n";
+            return 1;
+        }
+    }
+    if (peel < 1 || peel > MULTI_ROUND_MAX_PEEL) {
+        cerr << "Error: peel must be in 1.." << MULTI_ROUND_MAX_PEEL << "\n";
+        return 1;
+    }
+    int distRounds = spec.rounds - peel;
+    if (distRounds < 1) {
+        cerr << "Error: cipher has only " << spec.rounds << " rounds\n";
+        return 1;
+    }
+    if (trailName.empty()) trailName = "trail_results_" + to_string(distRounds) + "r.txt";
+
+    // 1. Дифференциал: dx0..dx3 dy0..dy3 PROB
+    ifstream in(trailName);
+    if (!in.is_open()) {
+        cerr << "Error: " << trailName << " not found (./trail_search --rounds=" << distRounds
+             << " --out=" << trailName << ").\n";
+        return 1;
+    }
+    int tdX[4], tdY[4];
+    double prob = 0.0;
+    in >> tdX[0] >> tdX[1] >> tdX[2] >> tdX[3] >> tdY[0] >> tdY[1] >> tdY[2] >> tdY[3] >> prob;
+    in.close();
+    if (prob <= 0) {
+        cerr << "Error: cannot read differential from " << trailName << "\n";
+        return 1;
+    }
+    const uint16_t dX = packNibbles(tdX);
+    const uint16_t dY = packNibbles(tdY);
+
+    // Объем данных: factor / P, от 1000 до 10 млн
+    long long needed = (long long)ceil(factor / prob);
+    if (needed > 10000000) needed = 10000000;
+    if (needed < 1000) needed = 1000;
+    size_t N = (size_t)needed;
+
+    cout << "--- Multi-Round Key Recovery (" << peel << " rounds peeled, "
+         << distRounds << "-round differential) ---\n";
+    cout << "dX=" << hex << setw(4) << setfill('0') << dX << " -> dY=" << setw(4) << dY
+         << dec << setfill(' ') << " P=" << prob << "\n";
+    cout << "Generating " << N << " chosen-plaintext pairs..." << endl;
+
+    // 2. Данные (кодбук — оракул шифрования)
+    Codebook CB;
+    if (!CB.open()) return 1;
+
+    PROFILE_STAGE(generate, "generate");
+    PairColumns pairs;
+    pairs.resize(N);
+    parallelFor(0, N, PARALLEL_GRAIN, [&](size_t b, size_t e, unsigned) {
+        const uint16_t* E = CB.encTable();
+        CounterRng(DEFAULT_DATA_SEED, RNG_STREAM_DIFF_PAIRS).fill16(b, e - b, &pairs.X[b]);
+        for (size_t i = b; i < e; ++i) {
+            uint16_t x = pairs.X[i];
+            pairs.dX[i] = dX;
+            pairs.Y[i] = E[x];
+            pairs.Yp[i] = E[x ^ dX];
+        }
+    });
+    PROFILE_STAGE_END(generate, N);
+
+    // 3. Совместный счет всех 16^L кандидатов
+    size_t numKeys = (size_t)1 << (4 * peel);
+    vector<long long> scores(numKeys, 0);
+    scoreMultiRoundParallel(pairs.Y.data(), pairs.Yp.data(), N, dY, peel, scores.data());
+
+    long long filtered = 0;
+    for (size_t i = 0; i < N; ++i) filtered += multiRoundFilter(pairs.Y[i], pairs.Yp[i], dY, peel);
+    cout << "Pairs passing filter: " << filtered << " / " << N << endl;
+
+    vector<uint32_t> order(numKeys);
+    for (size_t k = 0; k < numKeys; ++k) order[k] = (uint32_t)k;
+    stable_sort(order.begin(), order.end(),
+                [&](uint32_t a, uint32_t b) { return scores[a] > scores[b]; });
+
+    // 4. Кандидаты по убыванию счета -> полный мастер-ключ
+    PROFILE_STAGE(complete, "complete key");
+    size_t nVerify = min<size_t>(VERIFY_PAIRS, N);
+    bool found = false;
+    uint16_t master = 0;
+    size_t rank = 0;
+    for (; rank < numKeys && !found; ++rank) {
+        uint16_t partial;
+        int fixedMask;
+        if (!multiRoundToMaster(order[rank], peel, partial, fixedMask)) continue;
+        found = completeMasterKey(partial, fixedMask, pairs.X.data(), pairs.Y.data(), nVerify,
+                                  master);
+    }
+    PROFILE_STAGE_END(complete, rank);
+
+    auto keyName = [&](uint32_t key) {
+        string s;
+        for (int st = peel - 1; st >= 0; --st) {
+            s += "k" + to_string(spec.rounds - st) + "=" + to_string((key >> (4 * st)) & 0xF);
+            if (st) s += " ";
+        }
+        return s;
+    };
+
+    ofstream fout("multi_round_key_guess.txt");
+    cout << "\n--- Top Candidates ---\n";
+    for (size_t i = 0; i < numKeys && i < 10; ++i) {
+        cout << keyName(order[i]) << " | Hits: " << scores[order[i]] << endl;
+    }
+    for (size_t i = 0; i < numKeys; ++i)
+        fout << keyName(order[i]) << " Hits=" << scores[order[i]] << "\n";
+
+    if (!found) {
+        cout << "\nNo candidate extends to a consistent master key.\n";
+        fout << "Master=none\n";
+        return 1;
+    }
+
+    CipherSpec foundSpec = spec;
+    foundSpec.setMaster(master);
+    cout << "\nRecovered master key (candidate rank " << rank << "): t1..t4 = "
+         << (master >> 12) << " " << ((master >> 8) & 0xF) << " " << ((master >> 4) & 0xF)
+         << " " << (master & 0xF) << "\n";
+    cout << "Round keys:";
+    bool match = true;
+    for (int r = 0; r < spec.rounds; ++r) {
+        cout << " " << (int)foundSpec.roundKeys[r];
+        match = match && foundSpec.roundKeys[r] == spec.roundKeys[r];
+    }
+    cout << (match ? "  (matches cipher keys)" : "  (DOES NOT match cipher keys)") << endl;
+    fout << "Master=" << hex << setw(4) << setfill('0') << master << dec << " Rank=" << rank << "\n";
+    fout.close();
+
+    return 0;
+}
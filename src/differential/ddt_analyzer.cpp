@@ -4,6 +4,9 @@
 #include <algorithm>
 #include <fstream>
 #include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "ddt_table.h"
+#include "instrument.h"
 
 using namespace std;
 
@@ -15,18 +18,15 @@ struct SBoxTransition {
     double probability;
 };
 
-int main() {
-    int ddt[16][16] = {0};
+int main(int argc, char** argv) {
+    if (!parseCipherArgsOnly(argc, argv)) return 1;
 
-    // 1. Построение DDT
-    for (int d_in = 0; d_in < 16; ++d_in) {
-        for (int x = 0; x < 16; ++x) {
-            int y1 = G(x);
-            int y2 = G(x ^ d_in);
-            int d_out = y1 ^ y2;
-            ddt[d_in][d_out]++;
-        }
-    }
+    // 1. Построение DDT S-блока и DDT функции F
+    static DdtTables tables;
+    PROFILE_STAGE(build, "build tables");
+    buildDdtTables(tables);
+    PROFILE_STAGE_END(build, 0);
+    const int (&ddt)[16][16] = tables.sbox;
 
     // 2. Красивый вывод в файл
     ofstream out("ddt_pretty.txt");
@@ -54,11 +54,14 @@ int main() {
     cout << "Pretty DDT saved to 'ddt_pretty.txt'\n";
 
     // 3. Сохранение бинарного файла для Trail Search
-    FILE* f = fopen("ddt_table.bin", "wb");
-    if (f) {
-        fwrite(ddt, sizeof(int), 16 * 16, f);
-        fclose(f);
+    if (!writeDdtFile("ddt_table.bin", tables)) {
+        cerr << "Error: cannot write ddt_table.bin\n";
+        return 1;
     }
-    
+
+    int nonZero = 0;
+    for (int v = 0; v < 256; ++v) nonZero += tables.fNum[v];
+    cout << "DDT of S-Box and F (" << nonZero << " non-zero F transitions) saved to 'ddt_table.bin'\n";
+
     return 0;
-}
\ No newline at end of file
+}
@@ -1,20 +1,52 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <thread>
-#include <string>
 #include <algorithm>
 #include <cmath>
+#include <string>
 #include "cipher_engine.h"
+#include "codebook.h"
+#include "pair_io.h"
+#include "last_round.h"
+#include "adaptive_stop.h"
+#include "structures.h"
+#include "counter_rng.h"
+#include "thread_pool.h"
+#include "progress.h"
+#include "instrument.h"
 
 using namespace std;
 
-const int NUM_THREADS = 16;
-
 int TARGET_dX[4] = {0};
+int TARGET_dY[4] = {0};
 double TARGET_PROB = 0.0;
 int PAIRS_COUNT = 0;
 
+// Открытый текст пары i — блок i счетчикового генератора (--seed=S):
+// данные не зависят от числа потоков и порций
+uint64_t DATA_SEED = DEFAULT_DATA_SEED;
+
+// Адаптивный режим (--adaptive[=бит]): пары генерируются порциями, счет
+// ключей последнего раунда ведется по мере поступления данных, генерация
+// останавливается, когда оценка Сельчука дает целевое преимущество
+// (include/adaptive_stop.h). Верхний предел — --max-pairs, иначе 10 млн.
+bool ADAPTIVE = false;
+AdaptiveStop STOP;
+const int ADAPTIVE_FIRST_BATCH = 64;
+const int ADAPTIVE_MAX_PAIRS = 10000000;
+
+// Режим структур (--structures[=K]): открытые тексты — полные структуры
+// по активным нибблам dX (include/structures.h). Кроме целевой dX
+// используются до K следующих дифференциалов из trail_results.txt с той
+// же dY и dX внутри тех же нибблов (K = 0 — только целевая): атака
+// считает их попадания вместе.
+bool STRUCTURES = false;
+int STRUCTURE_DIFFS = 16;
+vector<uint16_t> STRUCTURE_DX;
+
+// Полный кодбук шифра: шифрование = одна загрузка из таблицы
+Codebook CB;
+
 void load_target_dx() {
     ifstream in("trail_results.txt");
     if (!in.is_open()) {
@@ -22,10 +54,9 @@ void load_target_dx() {
         exit(1);
     }
     // Читаем: dx0 dx1 dx2 dx3 dy0 dy1 dy2 dy3 PROB
-    // dy нам тут не нужны, но надо их прочитать, чтобы добраться до prob
-    int garbage;
+    // dy пишется в заголовок pairs_data.bin
     in >> TARGET_dX[0] >> TARGET_dX[1] >> TARGET_dX[2] >> TARGET_dX[3]
-       >> garbage >> garbage >> garbage >> garbage
+       >> TARGET_dY[0] >> TARGET_dY[1] >> TARGET_dY[2] >> TARGET_dY[3]
        >> TARGET_PROB;
     in.close();
     
@@ -40,74 +71,164 @@ void load_target_dx() {
     cout << "Loaded Target dX: " << TARGET_dX[0] << " " << TARGET_dX[1] 
          << " " << TARGET_dX[2] << " " << TARGET_dX[3] << endl;
     cout << "Theoretical Prob: " << TARGET_PROB << endl;
-    cout << "Generating " << PAIRS_COUNT << " pairs (Target ~ 8/P)...\n";
 }
 
-void worker(int tid, int count) {
-    string fname = "pairs_data_part_" + to_string(tid) + ".txt";
-    ofstream fout(fname);
-    uint32_t seed = 12345 + tid * 999;
-    
-    for (int i = 0; i < count; ++i) {
-        seed = seed * 1664525 + 1013904223;
-        int valX = seed & 0xFFFF;
-
-        Block X;
-        X.x[0] = (valX >> 12) & 0xF;
-        X.x[1] = (valX >> 8) & 0xF;
-        X.x[2] = (valX >> 4) & 0xF;
-        X.x[3] = valX & 0xF;
-
-        Block base = X;
-        encrypt(base);
-
-        Block Xp = X;
-        Xp.x[0] ^= TARGET_dX[0];
-        Xp.x[1] ^= TARGET_dX[1];
-        Xp.x[2] ^= TARGET_dX[2];
-        Xp.x[3] ^= TARGET_dX[3];
-
-        Block mod = Xp;
-        encrypt(mod);
-
-        fout << (int)X.x[0] << " " << (int)X.x[1] << " " << (int)X.x[2] << " " << (int)X.x[3] << " "
-             << (int)TARGET_dX[0] << " " << (int)TARGET_dX[1] << " " << (int)TARGET_dX[2] << " " << (int)TARGET_dX[3] << " "
-             << (int)base.x[0] << " " << (int)base.x[1] << " " << (int)base.x[2] << " " << (int)base.x[3] << " "
-             << (int)mod.x[0] << " " << (int)mod.x[1] << " " << (int)mod.x[2] << " " << (int)mod.x[3] << "\n";
+// Разности для структур: целевая dX и дифференциалы с той же dY внутри ее нибблов
+void load_structure_dx() {
+    uint16_t dX = packNibbles(TARGET_dX), dY = packNibbles(TARGET_dY);
+    uint16_t mask = structureMask(dX);
+    STRUCTURE_DX.assign(1, dX);
+    ifstream in("trail_results.txt");
+    int x[4], y[4];
+    double p;
+    while ((int)STRUCTURE_DX.size() < STRUCTURE_DIFFS + 1 &&
+           in >> x[0] >> x[1] >> x[2] >> x[3] >> y[0] >> y[1] >> y[2] >> y[3] >> p) {
+        uint16_t ox = packNibbles(x);
+        if (packNibbles(y) != dY || (ox & ~mask) || ox == 0) continue;
+        if (find(STRUCTURE_DX.begin(), STRUCTURE_DX.end(), ox) != STRUCTURE_DX.end()) continue;
+        STRUCTURE_DX.push_back(ox);
+        cout << "Structure dX: " << x[0] << " " << x[1] << " " << x[2] << " " << x[3]
+             << " (P=" << p << ")\n";
     }
-    fout.close();
 }
 
-int main() {
-    load_target_dx();
-    
-    vector<thread> threads;
-    int perThread = PAIRS_COUNT / NUM_THREADS;
-    if (perThread == 0) perThread = 1;
-
-    for (int t = 0; t < NUM_THREADS; ++t) {
-        // Коррекция для последнего потока (остаток)
-        int my_count = perThread;
-        if (t == NUM_THREADS - 1) my_count = PAIRS_COUNT - (NUM_THREADS - 1) * perThread;
-        if (my_count <= 0) break;
-        
-        threads.emplace_back(worker, t, my_count);
+// Структуры: базы (значения неактивных нибблов) без повторов в порядке
+// LCG-перестановки, потоки заполняют непересекающиеся структуры.
+void generate_structures(PairColumns& pairs) {
+    const uint16_t mask = structureMask(packNibbles(TARGET_dX));
+    const size_t perStructure = structurePairs(mask, STRUCTURE_DX.size());
+
+    vector<uint16_t> bases;
+    uint16_t v = 0;
+    do {
+        bases.push_back(v);
+        v = (uint16_t)((v - (uint16_t)~mask) & (uint16_t)~mask);
+    } while (v != 0);
+    const CounterRng rng(DATA_SEED, RNG_STREAM_STRUCTURES);
+    for (size_t i = bases.size(); i > 1; --i) swap(bases[i - 1], bases[rng.word(i) % i]);
+
+    size_t numStructures = ((size_t)PAIRS_COUNT + perStructure - 1) / perStructure;
+    if (numStructures > bases.size()) numStructures = bases.size();
+    size_t texts = numStructures * structureSize(mask);
+    cout << "Structures: " << numStructures << " x " << structureSize(mask) << " texts, "
+         << perStructure << " pairs each (" << STRUCTURE_DX.size() << " dX), "
+         << (double)(numStructures * perStructure) / texts << " pairs per encryption\n";
+
+    pairs.resize(numStructures * perStructure);
+    const uint16_t* E = CB.encTable();
+    ProgressMeter progress("Generating", numStructures * perStructure);
+    parallelFor(0, numStructures, 1, [&](size_t b, size_t e, unsigned) {
+        for (size_t s = b; s < e; ++s)
+            fillStructurePairs(E, bases[s], mask, STRUCTURE_DX, pairs, s * perStructure);
+        progress.add((e - b) * perStructure);
+    });
+    progress.finish();
+}
+
+// Заполнение среза [offset, offset+count) колонок
+void worker(int offset, int count, PairColumns& out) {
+    uint16_t dX = packNibbles(TARGET_dX);
+
+    CounterRng(DATA_SEED, RNG_STREAM_DIFF_PAIRS).fill16(offset, count, &out.X[offset]);
+    for (int i = offset; i < offset + count; ++i) {
+        uint16_t valX = out.X[i];
+
+        out.dX[i] = dX;
+        out.Y[i] = CB.enc(valX);
+        out.Yp[i] = CB.enc(valX ^ dX);
     }
+}
 
-    for (auto& th : threads) th.join();
+// Порция [offset, offset+count) режется на куски общего пула
+void generate_batch(int offset, int count, PairColumns& pairs, ProgressMeter* progress = nullptr) {
+    parallelFor(offset, offset + count, PARALLEL_GRAIN, [&](size_t b, size_t e, unsigned) {
+        worker((int)b, (int)(e - b), pairs);
+        if (progress) progress->add(e - b);
+    });
+}
 
-    ofstream out("pairs_data.txt");
-    for (int t = 0; t < NUM_THREADS; ++t) {
-        string fname = "pairs_data_part_" + to_string(t) + ".txt";
-        ifstream in(fname);
-        if(in) {
-            out << in.rdbuf();
-            in.close();
-            remove(fname.c_str());
+int main(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return 1;
+    long long maxPairs = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--adaptive") ADAPTIVE = true;
+        else if (arg.rfind("--adaptive=", 0) == 0) {
+            ADAPTIVE = true;
+            STOP.targetAdvantage = stod(arg.substr(11));
+        } else if (arg.rfind("--success=", 0) == 0) STOP.successProb = stod(arg.substr(10));
+        else if (arg.rfind("--max-pairs=", 0) == 0) maxPairs = stoll(arg.substr(12));
+        else if (arg.rfind("--seed=", 0) == 0) DATA_SEED = stoull(arg.substr(7));
+        else if (arg == "--structures") STRUCTURES = true;
+        else if (arg.rfind("--structures=", 0) == 0) {
+            STRUCTURES = true;
+            STRUCTURE_DIFFS = max(0, stoi(arg.substr(13)));
+        } else {
+            cerr << "Usage: " << argv[0] << " [--adaptive[=BITS]] [--success=P] [--max-pairs=N]"
+                 << " [--structures[=K]] [--seed=S] [--cipher=FILE] [--master=HEX]\n";
+            return 1;
+        }
+    }
+    if (ADAPTIVE && STRUCTURES) {
+        cerr << "Error: --adaptive and --structures are exclusive\n";
+        return 1;
+    }
+    if (!CB.open()) return 1;
+    load_target_dx();
+    if (ADAPTIVE) PAIRS_COUNT = ADAPTIVE_MAX_PAIRS;
+    if (maxPairs > 0) PAIRS_COUNT = (int)min<long long>(maxPairs, 1LL << 30);
+
+    PairColumns pairs;
+
+    PROFILE_STAGE(generate, "generate");
+    if (STRUCTURES) {
+        load_structure_dx();
+        generate_structures(pairs);
+    } else if (!ADAPTIVE) {
+        cout << "Generating " << PAIRS_COUNT << " pairs (Target ~ 8/P)...\n";
+        pairs.resize(PAIRS_COUNT);
+        ProgressMeter progress("Generating", PAIRS_COUNT);
+        generate_batch(0, PAIRS_COUNT, pairs, &progress);
+        progress.finish();
+    } else {
+        // Порции растут вдвое: число проверок ~ log(N), счет инкрементальный
+        const uint16_t dY = packNibbles(TARGET_dY);
+        long long scores[16] = {0};
+        AdaptiveEstimate est;
+        int done = 0;
+        int batch = min(ADAPTIVE_FIRST_BATCH, PAIRS_COUNT);
+        bool reached = false;
+        cout << "Adaptive: target advantage " << STOP.targetAdvantage << " bits at P_S="
+             << STOP.successProb << ", up to " << PAIRS_COUNT << " pairs\n";
+        while (done < PAIRS_COUNT && !reached) {
+            batch = min(batch, PAIRS_COUNT - done);
+            pairs.resize(done + batch);
+            generate_batch(done, batch, pairs);
+            scoreLastRound(pairs.Y.data() + done, pairs.Yp.data() + done, batch, dY, scores);
+            done += batch;
+            reached = STOP.differential(scores, 16, done, est);
+            cout << "  N=" << done << "  leader hits=" << (long long)(est.p * done + 0.5)
+                 << " (x" << est.leaders << ")  p=" << est.p << " q=" << est.q
+                 << "  advantage=" << est.advantage << " bits\n";
+            batch *= 2;
         }
+        if (!reached && STOP.targetAdvantage > tieAdvantageBound(16, est.leaders))
+            cout << "Target not reached (leader group of " << est.leaders
+                 << " of 16 keys: at most " << tieAdvantageBound(16, est.leaders) << " bits)\n";
+        else if (!reached)
+            cout << "Target not reached (estimated need ~" << (long long)min(est.needed, 1e18)
+                 << " pairs)\n";
     }
-    out.close();
+    PROFILE_STAGE_END(generate, pairs.size());
+
+    PairFileHeader h = makePairHeader(packNibbles(TARGET_dX), packNibbles(TARGET_dY),
+                                      TARGET_PROB, pairs.size());
+    if (!writePairFile("pairs_data.bin", h, pairs)) {
+        cerr << "Error writing pairs_data.bin\n";
+        return 1;
+    }
+    cout << "Saved " << pairs.size() << " pairs to pairs_data.bin\n";
     cout << "Done.\n";
 
     return 0;
-}
\ No newline at end of file
+}
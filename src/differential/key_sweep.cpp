@@ -0,0 +1,209 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iomanip>
+#include <cmath>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "pair_io.h"
+#include "multi_round.h"
+#include "counter_rng.h"
+#include "thread_pool.h"
+#include "progress.h"
+#include "instrument.h"
+
+using namespace std;
+
+// Прогон дифференциальной атаки по K случайным ключам в одном процессе:
+// генерация пар -> счет кандидатов -> ранг истинного ключа, без файлов
+// на каждый ключ. Ключи делятся между потоками, буферы пар и счетчиков
+// у потока одни на все его ключи.
+//
+// Ранг истинного ключа последних L раундов — при случайном выборе среди
+// равных по счету: успех с вероятностью 1 / (равных + 1), если лучше
+// никого нет, средний ранг 1 + лучших + равных / 2. "Однозначный"
+// успех — истинный ключ строго лучший.
+//
+// Использование:
+//   ./key_sweep [--keys=1000] [--peel=1] [--trail=trail_results.txt]
+//               [--pairs=N | --factor=8] [--seed=1] [--independent]
+//               [--cipher=FILE]
+// --independent — все раундовые ключи случайны (иначе случайный мастер-ключ).
+
+struct KeyResult {
+    int better;    // кандидатов со строго большим счетом
+    int ties;      // кандидатов с тем же счетом, кроме истинного
+    long long hits;
+};
+
+int main(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return 1;
+    const CipherSpec base = activeCipher();
+
+    int numKeys = 1000;
+    int peel = 1;
+    string trailName;
+    long long pairsArg = 0;
+    double factor = 8.0;
+    uint64_t seed = 1;
+    bool independent = false;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--keys=", 0) == 0) numKeys = stoi(arg.substr(7));
+        else if (arg.rfind("--peel=", 0) == 0) peel = stoi(arg.substr(7));
+        else if (arg.rfind("--trail=", 0) == 0) trailName = arg.substr(8);
+        else if (arg.rfind("--pairs=", 0) == 0) pairsArg = stoll(arg.substr(8));
+        else if (arg.rfind("--factor=", 0) == 0) factor = stod(arg.substr(9));
+        else if (arg.rfind("--seed=", 0) == 0) seed = stoull(arg.substr(7));
+        else if (arg == "--independent") independent = true;
+        else {
+            cerr << "Usage: " << argv[0] << " [--keys=K] [--peel=L] [--trail=FILE]"
+                 << " [--pairs=N | --factor=C] [--seed=S] [--independent] [--cipher=FILE]\n";
+            return 1;
+        }
+    }
+    if (numKeys < 1 || peel < 1 || peel > MULTI_ROUND_MAX_PEEL || base.rounds - peel < 1) {
+        cerr << "Error: need keys >= 1 and peel in 1.." << MULTI_ROUND_MAX_PEEL
+             << " (below " << base.rounds << " rounds)\n";
+        return 1;
+    }
+    if (trailName.empty())
+        trailName = peel == 1 ? "trail_results.txt"
+                              : "trail_results_" + to_string(base.rounds - peel) + "r.txt";
+
+    ifstream in(trailName);
+    int tdX[4], tdY[4];
+    double prob = 0.0;
+    if (!(in >> tdX[0] >> tdX[1] >> tdX[2] >> tdX[3] >> tdY[0] >> tdY[1] >> tdY[2] >> tdY[3] >> prob) ||
+        prob <= 0) {
+        cerr << "Error: cannot read differential from " << trailName << "\n";
+        return 1;
+    }
+    const uint16_t dX = packNibbles(tdX);
+    const uint16_t dY = packNibbles(tdY);
+
+    // Объем данных на ключ: --pairs или factor / P (от 1000 до 10 млн)
+    long long needed = pairsArg > 0 ? pairsArg : (long long)ceil(factor / prob);
+    if (pairsArg <= 0) needed = max(1000LL, min(10000000LL, needed));
+    const size_t N = (size_t)needed;
+
+    // Ключ i и его данные — функции от (seed, i) (include/counter_rng.h):
+    // результат не зависит от числа потоков
+    vector<CipherSpec> specs(numKeys, base);
+    const CounterRng keyRng(seed, RNG_STREAM_KEYS);
+    for (int i = 0; i < numKeys; ++i) {
+        uint64_t w = keyRng.word(i); // 16 нибблов = MAX_ROUNDS ключей
+        if (independent) {
+            for (int r = 0; r < specs[i].rounds; ++r) specs[i].roundKeys[r] = (uint8_t)((w >> (4 * r)) & 0xF);
+        } else {
+            specs[i].setMaster((uint16_t)w);
+        }
+    }
+
+    unsigned numThreads = min<unsigned>(poolThreads(), (unsigned)numKeys);
+
+    cout << "--- Key Sweep: " << numKeys << " keys, " << N << " pairs/key, "
+         << peel << " round(s) peeled, " << numThreads << " threads ---\n";
+    cout << "dX=" << hex << setw(4) << setfill('0') << dX << " -> dY=" << setw(4) << dY
+         << dec << setfill(' ') << " P=" << prob << " (" << trailName << ")" << endl;
+
+    const size_t numCand = (size_t)1 << (4 * peel);
+    vector<KeyResult> results(numKeys);
+
+    ProgressMeter progress("Sweep", numKeys, "keys");
+    // Ключи раздаются в общем пуле по одному; буферы — свои у исполнителя
+    struct SweepBuffers {
+        vector<uint16_t> Y, Yp;
+        vector<long long> scores;
+        long long filtered = 0;
+    };
+    vector<SweepBuffers> local(poolThreads());
+    parallelFor(0, numKeys, 1, [&](size_t lo, size_t hi, unsigned tid) {
+        SweepBuffers& buf = local[tid];
+        if (buf.Y.empty()) {
+            buf.Y.resize(N);
+            buf.Yp.resize(N);
+            buf.scores.resize(numCand);
+        }
+        vector<uint16_t>& Y = buf.Y;
+        vector<uint16_t>& Yp = buf.Yp;
+        vector<long long>& scores = buf.scores;
+        long long& filtered = buf.filtered;
+        for (size_t idx = lo; idx < hi; ++idx) {
+            const CipherSpec& spec = specs[idx];
+
+            // Генерация: шифрование по спецификации (раскрытый цикл раундов)
+            PROFILE_STAGE(encrypt, "encrypt");
+            CounterRng(seed, RNG_STREAM_DIFF_PAIRS, idx).fill16(0, N, Y.data());
+            for (size_t i = 0; i < N; ++i) {
+                uint16_t x = Y[i];
+                Y[i] = spec.encrypt(x);
+                Yp[i] = spec.encrypt(x ^ dX);
+                filtered += multiRoundFilter(Y[i], Yp[i], dY, peel);
+            }
+            PROFILE_STAGE_END(encrypt, N);
+
+            // Счет и ранг истинного ключа последних peel раундов
+            PROFILE_STAGE(score, "score");
+            fill(scores.begin(), scores.end(), 0);
+            scoreMultiRound(Y.data(), Yp.data(), N, dY, peel, scores.data());
+            PROFILE_STAGE_END(score, N);
+            uint32_t trueKey = 0;
+            for (int s = 0; s < peel; ++s)
+                trueKey |= (uint32_t)spec.roundKeys[spec.rounds - 1 - s] << (4 * s);
+
+            KeyResult& r = results[idx];
+            r.hits = scores[trueKey];
+            r.better = 0;
+            r.ties = 0;
+            for (size_t k = 0; k < numCand; ++k) {
+                if (scores[k] > r.hits) r.better++;
+                else if (scores[k] == r.hits && k != trueKey) r.ties++;
+            }
+            progress.add(1);
+        }
+    });
+    progress.finish();
+    long long filteredTotal = 0;
+    for (const SweepBuffers& buf : local) filteredTotal += buf.filtered;
+    double sec = progress.seconds();
+
+    // Сводка
+    double success = 0, rankSum = 0, hitSum = 0;
+    int unique = 0;
+    vector<int> rankHist(numCand + 1, 0);
+    for (const auto& r : results) {
+        if (r.better == 0) success += 1.0 / (r.ties + 1);
+        unique += r.better == 0 && r.ties == 0;
+        rankSum += 1 + r.better + r.ties / 2.0;
+        hitSum += r.hits;
+        rankHist[1 + r.better]++;
+    }
+
+    ofstream fout("key_sweep.txt");
+    auto report = [&](ostream& os) {
+        os << fixed << setprecision(4);
+        os << "Keys: " << numKeys << "  Pairs/key: " << N << "  Total pairs: " << (long long)N * numKeys << "\n";
+        os << "Pairs passing filter: " << (double)filteredTotal / numKeys << " per key\n";
+        os << "Success probability:         " << success / numKeys << "\n";
+        os << "Unique success (no ties):    " << (double)unique / numKeys << "\n";
+        os << "Average rank of true key:    " << rankSum / numKeys << " of " << numCand << "\n";
+        os << "Average hits of true key:    " << hitSum / numKeys << "\n";
+        os << "Rank histogram (1 + better):";
+        for (size_t r = 1; r <= numCand && r <= 16; ++r) os << " " << r << ":" << rankHist[r];
+        os << "\n" << defaultfloat << setprecision(6);
+    };
+    cout << "\n";
+    report(cout);
+    cout << "Time: " << fixed << setprecision(2) << sec << " s ("
+         << formatRate(numKeys / sec) << " keys/s, " << formatRate((double)N * numKeys / sec)
+         << " pairs/s)" << endl;
+    report(fout);
+    fout.close();
+    cout << "Summary saved to key_sweep.txt" << endl;
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "cipher_engine.h"
+#include "pair_io.h"
+
+using namespace std;
+
+// Конвертер между старым текстовым pairs_data.txt и бинарным pairs_data.bin.
+// Использование:
+//   ./pairs_convert to-bin  [pairs_data.txt] [pairs_data.bin]
+//   ./pairs_convert to-text [pairs_data.bin] [pairs_data.txt]
+// В текстовом формате нет траектории и хэша ключей: при to-bin траектория
+// берется из trail_results.txt (если есть), хэш — текущего расписания.
+
+int usage(const char* prog) {
+    cerr << "Usage: " << prog << " to-bin  [in.txt] [out.bin]\n"
+         << "       " << prog << " to-text [in.bin] [out.txt]\n";
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return 1;
+    if (argc < 2) return usage(argv[0]);
+    string mode = argv[1];
+
+    if (mode == "to-bin") {
+        string in = argc > 2 ? argv[2] : "pairs_data.txt";
+        string out = argc > 3 ? argv[3] : "pairs_data.bin";
+
+        PairColumns pairs;
+        if (!readPairsText(in, pairs)) {
+            cerr << "Error: cannot read " << in << "\n";
+            return 1;
+        }
+
+        int dX[4] = {0}, dY[4] = {0};
+        double prob = 0.0;
+        ifstream trail("trail_results.txt");
+        if (trail >> dX[0] >> dX[1] >> dX[2] >> dX[3] >> dY[0] >> dY[1] >> dY[2] >> dY[3] >> prob) {
+            cout << "Trail header taken from trail_results.txt\n";
+        }
+
+        PairFileHeader h = makePairHeader(packNibbles(dX), packNibbles(dY), prob, pairs.size());
+        if (!writePairFile(out, h, pairs)) {
+            cerr << "Error: cannot write " << out << "\n";
+            return 1;
+        }
+        cout << "Converted " << pairs.size() << " pairs: " << in << " -> " << out << "\n";
+    } else if (mode == "to-text") {
+        string in = argc > 2 ? argv[2] : "pairs_data.bin";
+        string out = argc > 3 ? argv[3] : "pairs_data.txt";
+
+        PairFile pf;
+        if (!pf.open(in)) {
+            cerr << "Error: cannot read " << in << "\n";
+            return 1;
+        }
+        if (!writePairsText(out, pf.X(), pf.dX(), pf.Y(), pf.Yp(), pf.count())) {
+            cerr << "Error: cannot write " << out << "\n";
+            return 1;
+        }
+        cout << "Converted " << pf.count() << " pairs: " << in << " -> " << out << "\n";
+    } else {
+        return usage(argv[0]);
+    }
+
+    return 0;
+}
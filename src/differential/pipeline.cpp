@@ -0,0 +1,178 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include "cipher_engine.h"
+#include "codebook.h"
+#include "bounded_queue.h"
+#include "last_round.h"
+#include "counter_rng.h"
+#include "thread_pool.h"
+#include "progress.h"
+#include "instrument.h"
+
+using namespace std;
+
+// Потоковый конвейер "генерация -> атака" без промежуточных файлов.
+// Пары идут от генераторов к оценщикам пакетами через ограниченную
+// lock-free очередь; буферы пакетов переиспользуются, поэтому память
+// не зависит от числа пар. Набор пар совпадает с generator_of_data
+// (X пары i — блок i счетчикового генератора, include/counter_rng.h),
+// поэтому и результат совпадает с attack при том же --seed.
+// Использование:
+//   ./pipeline [--seed=S] [--cipher=FILE] [--master=HEX]
+
+const int NUM_STREAMS = 16;     // срезы индексов пар между генераторами
+const int BATCH_SIZE = 4096;    // пар в пакете
+const int BATCHES_IN_FLIGHT = 64;
+
+int TARGET_dX[4] = {0};
+int TARGET_dY[4] = {0};
+double TARGET_PROB = 0.0;
+int PAIRS_COUNT = 0;
+uint64_t DATA_SEED = DEFAULT_DATA_SEED;
+
+Codebook CB;
+
+struct PairBatch {
+    uint16_t Y[BATCH_SIZE];
+    uint16_t Yp[BATCH_SIZE];
+    int n;
+};
+
+void load_trail() {
+    ifstream in("trail_results.txt");
+    if (!in.is_open()) {
+        cerr << "Error: trail_results.txt not found.\n";
+        exit(1);
+    }
+    in >> TARGET_dX[0] >> TARGET_dX[1] >> TARGET_dX[2] >> TARGET_dX[3]
+       >> TARGET_dY[0] >> TARGET_dY[1] >> TARGET_dY[2] >> TARGET_dY[3]
+       >> TARGET_PROB;
+    in.close();
+
+    // Тот же объем данных, что и в generator_of_data: 8/P, от 1000 до 10 млн
+    long long needed = (long long)ceil(8.0 / TARGET_PROB);
+    if (needed > 10000000) needed = 10000000;
+    if (needed < 1000) needed = 1000;
+    PAIRS_COUNT = (int)needed;
+
+    cout << "Target dX: " << TARGET_dX[0] << " " << TARGET_dX[1] << " " << TARGET_dX[2] << " " << TARGET_dX[3] << endl;
+    cout << "Target dY: " << TARGET_dY[0] << " " << TARGET_dY[1] << " " << TARGET_dY[2] << " " << TARGET_dY[3] << endl;
+    cout << "Streaming " << PAIRS_COUNT << " pairs..." << endl;
+}
+
+int main(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return 1;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--seed=", 0) == 0) DATA_SEED = stoull(arg.substr(7));
+        else {
+            cerr << "Usage: " << argv[0] << " [--seed=S] [--cipher=FILE] [--master=HEX]\n";
+            return 1;
+        }
+    }
+    if (!CB.open()) return 1;
+    load_trail();
+
+    const uint16_t dX = (uint16_t)((TARGET_dX[0] << 12) | (TARGET_dX[1] << 8) | (TARGET_dX[2] << 4) | TARGET_dX[3]);
+    const uint16_t dY = (uint16_t)((TARGET_dY[0] << 12) | (TARGET_dY[1] << 8) | (TARGET_dY[2] << 4) | TARGET_dY[3]);
+
+    // Размер — как у общего пула (GFN_THREADS), но потоки свои: производители
+    // и оценщики блокируются на очередях и в пул задач не годятся
+    unsigned hw = ThreadPool::defaultSize();
+    int numProducers = max(1, (int)hw / 2);
+    int numScorers = max(1, (int)hw - numProducers);
+
+    // Пул буферов: свободные и заполненные пакеты ходят по двум очередям
+    vector<PairBatch> pool(BATCHES_IN_FLIGHT);
+    BoundedQueue<PairBatch*> freeQ(BATCHES_IN_FLIGHT);
+    BoundedQueue<PairBatch*> fullQ(BATCHES_IN_FLIGHT + numScorers);
+    for (auto& b : pool) freeQ.push(&b);
+
+    int perStream = PAIRS_COUNT / NUM_STREAMS;
+    if (perStream == 0) perStream = 1;
+
+    // --- Генераторы ---
+    auto producer = [&](int pid) {
+        const uint16_t* E = CB.encTable();
+        const CounterRng rng(DATA_SEED, RNG_STREAM_DIFF_PAIRS);
+        for (int s = pid; s < NUM_STREAMS; s += numProducers) {
+            int count = perStream;
+            if (s == NUM_STREAMS - 1) count = PAIRS_COUNT - (NUM_STREAMS - 1) * perStream;
+            if (count <= 0) continue;
+
+            uint16_t X[BATCH_SIZE];
+            for (int done = 0; done < count;) {
+                PairBatch* b;
+                freeQ.pop(b);
+                int n = min(BATCH_SIZE, count - done);
+                PROFILE_STAGE(produce, "produce batch");
+                rng.fill16((uint64_t)s * perStream + done, n, X);
+                for (int i = 0; i < n; ++i) {
+                    uint16_t x = X[i];
+                    b->Y[i] = E[x];
+                    b->Yp[i] = E[x ^ dX];
+                }
+                PROFILE_STAGE_END(produce, n);
+                b->n = n;
+                done += n;
+                fullQ.push(b);
+            }
+        }
+    };
+
+    // --- Оценщики: фильтр + счет попаданий для 16 ключей ---
+    vector<vector<long long>> localScores(numScorers, vector<long long>(16, 0));
+    atomic<long long> filtered(0);
+    ProgressMeter progress("Pipeline", PAIRS_COUNT);
+    auto scorer = [&](int sid) {
+        long long* scores = localScores[sid].data();
+        long long kept = 0;
+        for (;;) {
+            PairBatch* b;
+            fullQ.pop(b);
+            if (b == nullptr) break;
+            PROFILE_STAGE(score, "score batch");
+            for (int i = 0; i < b->n; ++i) kept += lastRoundFilter(b->Y[i], b->Yp[i], dY);
+            scoreLastRound(b->Y, b->Yp, b->n, dY, scores);
+            PROFILE_STAGE_END(score, b->n);
+            progress.add(b->n);
+            freeQ.push(b);
+        }
+        filtered += kept;
+    };
+
+    vector<thread> producers, scorers;
+    for (int i = 0; i < numScorers; ++i) scorers.emplace_back(scorer, i);
+    for (int i = 0; i < numProducers; ++i) producers.emplace_back(producer, i);
+    for (auto& th : producers) th.join();
+    for (int i = 0; i < numScorers; ++i) fullQ.push(nullptr); // сигнал завершения
+    for (auto& th : scorers) th.join();
+    progress.finish();
+
+    vector<long long> key_scores(16, 0);
+    for (const auto& ls : localScores)
+        for (int k = 0; k < 16; ++k) key_scores[k] += ls[k];
+
+    cout << "Pairs passing filter: " << filtered.load() << " / " << PAIRS_COUNT << endl;
+
+    // Вывод в том же формате, что и attack_last_round
+    ofstream fout("last_round_key_guess.txt");
+    cout << "\n--- Attack Results ---\n";
+    vector<pair<long long, int>> results;
+    for (int k = 0; k < 16; ++k) results.push_back({key_scores[k], k});
+
+    sort(results.begin(), results.end(), [](auto& a, auto& b) { return a.first > b.first; });
+
+    for (const auto& res : results) {
+        cout << "Key = " << res.second << " (0x" << hex << res.second << dec << ") | Hits: " << res.first << endl;
+        fout << "Key=" << res.second << " Hits=" << res.first << "\n";
+    }
+    fout.close();
+
+    return 0;
+}
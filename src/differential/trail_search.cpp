@@ -1,56 +1,48 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <map>
 #include <iomanip>
 #include <fstream>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <chrono>
 #include "cipher_engine.h"
+#include "flat_hash.h"
+#include "thread_pool.h"
+#include "progress.h"
+#include "instrument.h"
+#include "ddt_table.h"
 
 using namespace std;
 
-double DDT_PROB[16][16];
+// Поиск дифференциальных траекторий методом ветвей и границ (в духе Мацуи).
+//  1. Границы: BOUND[r] — вероятность лучшей r-раундовой характеристики.
+//     Считаются по очереди для r = 1..R; при поиске r раундов ветка
+//     отсекается, если p * BOUND[оставшиеся раунды] не лучше найденного.
+//     Результат оптимален (без луча и без порога).
+//  2. Кластеризация: перечисляются все характеристики с вероятностью
+//     не ниже порога, их вероятности суммируются по (dX, dY) —
+//     это оценка вероятности дифференциала.
+// Стартовые dX распределяются по всем ядрам.
+//
+// Использование:
+//   ./trail_search [--rounds=5] [--threshold=1e-5] [--top=20] [--out=trail_results.txt]
 
-void load_ddt() {
-    int ddt_int[16][16];
-    FILE* f = fopen("ddt_table.bin", "rb");
-    if (!f) {
-        cerr << "Error: ddt_table.bin not found.\n";
-        exit(1);
-    }
-    if (fread(ddt_int, sizeof(int), 16 * 16, f) != 16 * 16) {
-        cerr << "Error reading ddt_table.bin\n";
-        fclose(f);
-        exit(1);
-    }
-    fclose(f);
-    for(int i=0; i<16; ++i)
-        for(int j=0; j<16; ++j)
-            DDT_PROB[i][j] = (double)ddt_int[i][j] / 16.0;
-}
+// DDT S-блока и функции F из ddt_table.bin (ddt_gen)
+DdtTables T;
 
-double get_prob_F(int dx2, int dx3, int dout) {
-    double total_prob = 0.0;
-    for (int d_mid = 0; d_mid < 16; ++d_mid) {
-        double p1 = DDT_PROB[dx3][d_mid];
-        if (p1 == 0) continue;
-        int second_in = dx2 ^ d_mid;
-        double p2 = DDT_PROB[second_in][dout];
-        if (p2 > 0) total_prob += p1 * p2;
-    }
-    return total_prob;
-}
+// BOUND[r] — лучшая вероятность r-раундовой характеристики, BOUND[0] = 1
+double BOUND[NUM_ROUNDS + 1];
 
-struct State {
-    uint16_t initial_dx; 
-    uint16_t current_dx; 
-    double prob;
-    // Для отладки можно хранить путь, но это дорого по памяти.
-    // Ограничимся выводом результата.
+const int START_CHUNK = 256;
 
-    bool operator<(const State& other) const {
-        return prob > other.prob;
+void load_ddt() {
+    if (!readDdtFile("ddt_table.bin", T)) {
+        cerr << "Error: ddt_table.bin not found or outdated, run ./ddt_gen first.\n";
+        exit(1);
     }
-};
+}
 
 uint16_t pack(int x0, int x1, int x2, int x3) {
     return (x0 << 12) | (x1 << 8) | (x2 << 4) | x3;
@@ -63,159 +55,292 @@ void unpack(uint16_t val, int& x0, int& x1, int& x2, int& x3) {
     x3 = val & 0xF;
 }
 
-int main() {
-    load_ddt();
-    const int BEAM_WIDTH = 20000;
-    const int ROUNDS = 5;
+// Раунд над упакованной разностью: (d0,d1,d2,d3) -> (d1,d2,d3,d0^dF)
+inline uint16_t next_state(uint16_t s, int dF) {
+    return (uint16_t)((s << 4) | ((s >> 12) ^ dF));
+}
+
+void atomic_max(atomic<double>& a, double v) {
+    double cur = a.load(memory_order_relaxed);
+    while (v > cur && !a.compare_exchange_weak(cur, v, memory_order_relaxed)) {}
+}
+
+struct Trail {
+    double prob = 0.0;
+    uint16_t start = 0;
+    uint8_t dF[NUM_ROUNDS] = {0};
+};
+
+// --- 1. Лучшая характеристика ---
 
-    vector<State> current_states;
-    for (int val = 1; val < 65536; ++val) {
-        current_states.push_back({(uint16_t)val, (uint16_t)val, 1.0});
+void dfs_best(int rounds, int d, uint16_t state, double p, Trail& cur, Trail& best,
+              atomic<double>& global) {
+    if (d == rounds) {
+        // Равные по вероятности — меньший старт: куски стартов исполнитель
+        // берет не по порядку (кража работы)
+        if (p > best.prob || (p == best.prob && cur.start < best.start)) {
+            best = cur;
+            best.prob = p;
+        }
+        atomic_max(global, p);
+        return;
+    }
+    // Переходы по убыванию вероятности: первый отсеченный — отсекает и остальные.
+    // Отсечение строгое: ветка, равная лучшей найденной, проходится, иначе
+    // из равных характеристик печаталась бы первая найденная, а не с меньшим стартом.
+    int v = state & 0xFF;
+    double rest = BOUND[rounds - d - 1];
+    for (int i = 0; i < T.fNum[v]; ++i) {
+        const FTransition& t = T.fList[v][i];
+        double q = p * t.prob;
+        if (q * rest < global.load(memory_order_relaxed)) break;
+        cur.dF[d] = t.dF;
+        dfs_best(rounds, d + 1, next_state(state, t.dF), q, cur, best, global);
     }
+}
 
-    cout << "Starting Search. Initial states: " << current_states.size() << endl;
+Trail search_best(int rounds) {
+    atomic<double> global(0.0);
+    vector<Trail> best(poolThreads());
 
-    ofstream debug_log("trail_debug.txt");
-    debug_log << "--- Trail Search Log ---\\n";
-
-    for (int r = 1; r <= ROUNDS; ++r) {
-        map<pair<uint16_t, uint16_t>, double> next_map;
-        
-        int processed = 0;
-        for (const auto& s : current_states) {
-            int dx[4];
-            unpack(s.current_dx, dx[0], dx[1], dx[2], dx[3]);
-
-            for (int dF = 0; dF < 16; ++dF) {
-                double p_trans = get_prob_F(dx[2], dx[3], dF);
-                if (p_trans > 0) {
-                    double new_p = s.prob * p_trans;
-                    if (new_p < 0.00001) continue;
-
-                    int nx0 = dx[1];
-                    int nx1 = dx[2];
-                    int nx2 = dx[3];
-                    int nx3 = dx[0] ^ dF;
-                    
-                    uint16_t next_packed = pack(nx0, nx1, nx2, nx3);
-                    next_map[{s.initial_dx, next_packed}] += new_p;
-                }
-            }
-            if (r==1 && ++processed % 5000 == 0) cout << "." << flush;
+    parallelFor(1, 65536, START_CHUNK, [&](size_t lo, size_t hi, unsigned tid) {
+        Trail cur;
+        for (size_t s = lo; s < hi; ++s) {
+            cur.start = (uint16_t)s;
+            dfs_best(rounds, 0, (uint16_t)s, 1.0, cur, best[tid], global);
         }
-        if (r==1) cout << endl;
+    });
+
+    Trail r;
+    for (const auto& b : best)
+        if (b.prob > r.prob || (b.prob == r.prob && b.prob > 0 && b.start < r.start)) r = b;
+    return r;
+}
+
+// --- 2. Перечисление траекторий выше порога (кластеризация) ---
+
+void dfs_enum(int rounds, int d, uint16_t start, uint16_t state, double p, double threshold,
+              FlatHashMap<double>& acc, long long& trails) {
+    if (d == rounds) {
+        acc[((uint64_t)start << 16) | state] += p;
+        ++trails;
+        return;
+    }
+    int v = state & 0xFF;
+    double rest = BOUND[rounds - d - 1];
+    for (int i = 0; i < T.fNum[v]; ++i) {
+        const FTransition& t = T.fList[v][i];
+        double q = p * t.prob;
+        if (q * rest < threshold) break;
+        dfs_enum(rounds, d + 1, start, next_state(state, t.dF), q, threshold, acc, trails);
+    }
+}
+
+struct Differential {
+    uint16_t dX;
+    uint16_t dY;
+    double prob;
+};
+
+bool differential_better(const Differential& a, const Differential& b) {
+    if (a.prob != b.prob) return a.prob > b.prob;
+    if (a.dX != b.dX) return a.dX < b.dX;
+    return a.dY < b.dY;
+}
 
-        vector<State> next_gen;
-        next_gen.reserve(next_map.size());
-        for (auto const& [key, prob] : next_map) {
-            next_gen.push_back({key.first, key.second, prob});
+// Кластеры считаются по одному старту dX за раз (все траектории из dX
+// уже в таблице), после чего в кучу исполнителя попадают только лучшие top.
+// Память не зависит от числа найденных траекторий.
+vector<Differential> enumerate_differentials(int rounds, double threshold, size_t top,
+                                             long long& totalTrails, long long& totalDiffs) {
+    unsigned numThreads = poolThreads();
+    vector<vector<Differential>> heaps(numThreads);
+    vector<unique_ptr<FlatHashMap<double>>> accs(numThreads);
+    vector<long long> trails(numThreads, 0), diffs(numThreads, 0);
+
+    ProgressMeter progress("Enumerating", 65535, "starts");
+    parallelFor(1, 65536, START_CHUNK, [&](size_t lo, size_t hi, unsigned tid) {
+        if (!accs[tid]) accs[tid].reset(new FlatHashMap<double>());
+        FlatHashMap<double>& acc = *accs[tid];
+        vector<Differential>& heap = heaps[tid];
+        for (size_t s = lo; s < hi; ++s) {
+            dfs_enum(rounds, 0, (uint16_t)s, (uint16_t)s, 1.0, threshold, acc, trails[tid]);
+            diffs[tid] += acc.size();
+            acc.forEach([&](uint64_t key, double p) {
+                Differential e{(uint16_t)(key >> 16), (uint16_t)key, p};
+                if (heap.size() < top) {
+                    heap.push_back(e);
+                    push_heap(heap.begin(), heap.end(), differential_better);
+                } else if (differential_better(e, heap.front())) {
+                    pop_heap(heap.begin(), heap.end(), differential_better);
+                    heap.back() = e;
+                    push_heap(heap.begin(), heap.end(), differential_better);
+                }
+            });
+            if (acc.size()) acc.clear();
         }
-        
-        sort(next_gen.begin(), next_gen.end());
-        
-        if (next_gen.size() > BEAM_WIDTH) {
-            next_gen.resize(BEAM_WIDTH);
+        progress.add(hi - lo);
+    });
+    progress.finish();
+
+    vector<Differential> all;
+    totalTrails = 0;
+    totalDiffs = 0;
+    for (unsigned t = 0; t < numThreads; ++t) {
+        all.insert(all.end(), heaps[t].begin(), heaps[t].end());
+        totalTrails += trails[t];
+        totalDiffs += diffs[t];
+    }
+    sort(all.begin(), all.end(), differential_better);
+    if (all.size() > top) all.resize(top);
+    return all;
+}
+
+// Подробная трассировка характеристики
+void trace_path(const Trail& t, int rounds) {
+    cout << "\n--- TRACING BEST TRAIL (Detailed) ---\n";
+    cout << "Start dX: " << hex << t.start << dec << endl;
+
+    int dx[4];
+    unpack(t.start, dx[0], dx[1], dx[2], dx[3]);
+    double total_p = 1.0;
+
+    for (int r = 1; r <= rounds; ++r) {
+        cout << "Round " << r << ": Input ("
+             << dx[0]<<","<<dx[1]<<","<<dx[2]<<","<<dx[3] << ")\n";
+
+        int dF = t.dF[r - 1];
+        double p = T.fProb[(dx[2] << 4) | dx[3]][dF];
+        cout << "  F(x2=" << dx[2] << ", x3=" << dx[3] << ") -> dF=" << dF
+             << " (Total P=" << p << ")\n";
+
+        // Восстанавливаем, из чего сложилась эта вероятность
+        cout << "     Breakdown:\n";
+        for (int d_mid = 0; d_mid < 16; ++d_mid) {
+            double p1 = T.sboxProb[dx[3]][d_mid]; // G(x3) -> mid
+            if (p1 == 0) continue;
+
+            int second_in = dx[2] ^ d_mid;
+            double p2 = T.sboxProb[second_in][dF]; // G(x2^mid) -> out
+
+            if (p2 > 0) {
+                cout << "      G(" << dx[3] << ")->" << hex << uppercase << d_mid << dec
+                     << " (p=" << p1 << ") AND G(" << second_in << ")->" << dF
+                     << " (p=" << p2 << ") => Path P=" << p1*p2 << "\n";
+            }
         }
-        current_states = next_gen;
-
-        cout << "Round " << r << " complete. Top prob: " << current_states[0].prob 
-             << " (States: " << current_states.size() << ")\n";
-
-        // Логирование топа для отладки
-        debug_log << "--- Round " << r << " Top 5 ---\\n";
-        for(size_t i=0; i<5 && i<current_states.size(); ++i) {
-             int in[4], out[4];
-             unpack(current_states[i].initial_dx, in[0], in[1], in[2], in[3]);
-             unpack(current_states[i].current_dx, out[0], out[1], out[2], out[3]);
-             debug_log << i+1 << ") In:("<<in[0]<<","<<in[1]<<","<<in[2]<<","<<in[3]<<")"
-                       << " Out:("<<out[0]<<","<<out[1]<<","<<out[2]<<","<<out[3]<<")"
-                       << " P=" << current_states[i].prob << "\n";
+
+        total_p *= p;
+
+        int temp = dx[0] ^ dF;
+        dx[0] = dx[1];
+        dx[1] = dx[2];
+        dx[2] = dx[3];
+        dx[3] = temp;
+
+        cout << "  Output (" << dx[0]<<","<<dx[1]<<","<<dx[2]<<","<<dx[3] << ")\n";
+        cout << "  Accumulated Prob: " << total_p << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = 5;
+    double threshold = 1e-5;
+    size_t top = 20;
+    string outName = "trail_results.txt";
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--rounds=", 0) == 0) rounds = stoi(arg.substr(9));
+        else if (arg.rfind("--threshold=", 0) == 0) threshold = stod(arg.substr(12));
+        else if (arg.rfind("--top=", 0) == 0) top = stoul(arg.substr(6));
+        else if (arg.rfind("--out=", 0) == 0) outName = arg.substr(6);
+        else {
+            cerr << "Usage: " << argv[0] << " [--rounds=N] [--threshold=P] [--top=K] [--out=FILE]\n";
+            return 1;
         }
     }
+    if (rounds < 1 || rounds > NUM_ROUNDS) {
+        cerr << "Error: rounds must be in 1.." << NUM_ROUNDS << "\n";
+        return 1;
+    }
+
+    load_ddt();
+
+    unsigned numThreads = poolThreads();
+
+    cout << "Starting Branch-and-Bound Search (" << rounds << " rounds, "
+         << numThreads << " threads)" << endl;
+
+    ofstream debug_log("trail_debug.txt");
+    debug_log << "--- Trail Search Log ---\n";
+
+    // 1. Границы Мацуи для r = 1..rounds
+    auto t0 = chrono::steady_clock::now();
+    PROFILE_STAGE(bounds, "bounds");
+    BOUND[0] = 1.0;
+    vector<Trail> bestByRound(rounds + 1);
+    for (int r = 1; r <= rounds; ++r) {
+        bestByRound[r] = search_best(r);
+        BOUND[r] = bestByRound[r].prob;
+        cout << "Round " << r << " bound: best characteristic P=" << BOUND[r]
+             << " (start dX=" << hex << bestByRound[r].start << dec << ")\n";
+        debug_log << "B[" << r << "] = " << BOUND[r] << " start=" << bestByRound[r].start << "\n";
+    }
+    PROFILE_STAGE_END(bounds, rounds);
+    double boundSec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    // 2. Дифференциалы: все характеристики с P >= threshold
+    t0 = chrono::steady_clock::now();
+    long long trails = 0, clusters = 0;
+    PROFILE_STAGE(enumerate, "enumerate");
+    vector<Differential> diffs = enumerate_differentials(rounds, threshold, top, trails, clusters);
+    PROFILE_STAGE_END(enumerate, 65535);
+    PROFILE_COUNT("map inserts", trails);
+    double enumSec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    cout << "Enumerated " << trails << " trails with P >= " << threshold
+         << " into " << clusters << " differentials" << endl;
+    cout << "Time: bounds " << fixed << setprecision(2) << boundSec << " s, clustering "
+         << enumSec << " s" << defaultfloat << setprecision(6) << endl;
+
+    debug_log << "--- Top " << min<size_t>(top, diffs.size()) << " differentials ("
+              << trails << " trails, threshold " << threshold << ") ---\n";
+    for (size_t i = 0; i < top && i < diffs.size(); ++i) {
+        int in[4], out[4];
+        unpack(diffs[i].dX, in[0], in[1], in[2], in[3]);
+        unpack(diffs[i].dY, out[0], out[1], out[2], out[3]);
+        debug_log << i+1 << ") In:("<<in[0]<<","<<in[1]<<","<<in[2]<<","<<in[3]<<")"
+                  << " Out:("<<out[0]<<","<<out[1]<<","<<out[2]<<","<<out[3]<<")"
+                  << " P=" << diffs[i].prob << "\n";
+    }
     debug_log.close();
 
-    cout << "\n--- TOP ANALYTICAL DIFFERENTIALS (5 Rounds) ---\\n";
+    cout << "\n--- TOP ANALYTICAL DIFFERENTIALS (" << rounds << " Rounds) ---\n";
     cout << "Detailed log saved to trail_debug.txt\n";
-    
-    // Функция трассировки лучшего пути
-    auto trace_path = [&](uint16_t start_val) {
-        cout << "\n--- TRACING BEST TRAIL (Detailed) ---\n";
-        cout << "Start dX: " << hex << start_val << dec << endl;
-        
-        int dx[4];
-        unpack(start_val, dx[0], dx[1], dx[2], dx[3]);
-        double total_p = 1.0;
-
-        for(int r=1; r<=ROUNDS; ++r) {
-            cout << "Round " << r << ": Input (" 
-                 << dx[0]<<","<<dx[1]<<","<<dx[2]<<","<<dx[3] << ")\n";
-            
-            // 1. Ищем лучший dF
-            int best_dF = -1;
-            double best_p = -1.0;
-
-            for(int dF=0; dF<16; ++dF) {
-                double p = get_prob_F(dx[2], dx[3], dF);
-                if (p > best_p) {
-                    best_p = p;
-                    best_dF = dF;
-                }
-            }
-            
-            // 2. Детализация вероятности для лучшего dF
-            cout << "  F(x2=" << dx[2] << ", x3=" << dx[3] << ") -> dF=" << best_dF 
-                 << " (Total P=" << best_p << ")\n";
-            
-            // Восстанавливаем, из чего сложилась эта вероятность
-            cout << "     Breakdown:\n";
-            for (int d_mid = 0; d_mid < 16; ++d_mid) {
-                double p1 = DDT_PROB[dx[3]][d_mid]; // G(x3) -> mid
-                if (p1 == 0) continue;
-                
-                int second_in = dx[2] ^ d_mid;
-                double p2 = DDT_PROB[second_in][best_dF]; // G(x2^mid) -> out
-                
-                if (p2 > 0) {
-                    cout << "      G(" << dx[3] << ")->" << hex << uppercase << d_mid << dec 
-                         << " (p=" << p1 << ") AND G(" << second_in << ")->" << best_dF 
-                         << " (p=" << p2 << ") => Path P=" << p1*p2 << "\n";
-                }
-            }
-            
-            total_p *= best_p;
-            
-            // Update state
-            int temp = dx[0] ^ best_dF;
-            dx[0] = dx[1];
-            dx[1] = dx[2];
-            dx[2] = dx[3];
-            dx[3] = temp;
-            
-            cout << "  Output (" << dx[0]<<","<<dx[1]<<","<<dx[2]<<","<<dx[3] << ")\n";
-            cout << "  Accumulated Prob: " << total_p << endl;
-        }
-    };
 
-    ofstream out("trail_results.txt");
-    // Пишем данные лучшей траектории
-    if (!current_states.empty()) {
-        const auto& s = current_states[0];
+    // Ранжированный список: первая строка — лучший дифференциал
+    // (ее читают generator_of_data и attack_last_round)
+    ofstream out(outName);
+    for (size_t i = 0; i < top && i < diffs.size(); ++i) {
         int in[4], out_d[4];
-        unpack(s.initial_dx, in[0], in[1], in[2], in[3]);
-        unpack(s.current_dx, out_d[0], out_d[1], out_d[2], out_d[3]);
-        
-        cout << "1) dX=(" << in[0]<<","<<in[1]<<","<<in[2]<<","<<in[3] << ")"
-             << " -> dY=(" << out_d[0]<<","<<out_d[1]<<","<<out_d[2]<<","<<out_d[3] << ")"
-             << " Prob=" << s.prob << "\n";
-             
+        unpack(diffs[i].dX, in[0], in[1], in[2], in[3]);
+        unpack(diffs[i].dY, out_d[0], out_d[1], out_d[2], out_d[3]);
+
+        if (i < 5) {
+            cout << i+1 << ") dX=(" << in[0]<<","<<in[1]<<","<<in[2]<<","<<in[3] << ")"
+                 << " -> dY=(" << out_d[0]<<","<<out_d[1]<<","<<out_d[2]<<","<<out_d[3] << ")"
+                 << " Prob=" << diffs[i].prob << "\n";
+        }
         out << in[0]<<" "<<in[1]<<" "<<in[2]<<" "<<in[3] << " "
             << out_d[0]<<" "<<out_d[1]<<" "<<out_d[2]<<" "<<out_d[3] << " "
-            << s.prob << "\n";
-            
-        // Запускаем трассировку
-        trace_path(s.initial_dx);
+            << diffs[i].prob << "\n";
     }
     out.close();
+    cout << "Saved to " << outName << endl;
+
+    // Оптимальная характеристика
+    trace_path(bestByRound[rounds], rounds);
 
     return 0;
 }
@@ -1,14 +1,19 @@
 #include "cipher_engine.h"
+#include "linear_key.h"
+#include "linear_multi.h"
+#include "codebook.h"
+#include "instrument.h"
 #include <vector>
+#include <string>
 #include <iostream>
 #include <fstream>
 #include <cmath>
 #include <algorithm>
 #include <iomanip>
 
-// Константы из linear_result_5_rounds.txt (Rank 1)
-const uint16_t TARGET_MASK_IN = 0x4;
-const uint16_t TARGET_MASK_OUT = 0x2140;
+// Константы из linear_result_5_rounds.txt (Rank 1), см. linear_key.h
+const uint16_t TARGET_MASK_IN = LINEAR_TARGET_MASK_IN;
+const uint16_t TARGET_MASK_OUT = LINEAR_TARGET_MASK_OUT;
 
 struct KeyScore {
     int key;
@@ -20,57 +25,136 @@ bool compareKeyScores(const KeyScore& a, const KeyScore& b) {
     return a.bias > b.bias;
 }
 
-int main() {
+// Многомерный режим (--multi[=m] [--stat=chi2|llr]): первые m независимых
+// приближений из linear_result_5_rounds.txt (или --approx=FILE, например
+// linear_trail_results.txt), гистограммы векторов четностей по всем 16
+// ключам (include/linear_multi.h)
+int run_multi(int dim, bool llr, const std::string& approxFile) {
+    std::vector<LinearApprox> ap = selectIndependent(readLinearResults(approxFile), dim);
+    if (ap.empty()) {
+        std::cerr << "Error: no approximations in " << approxFile
+                  << " (run ./linear_search or ./linear_trail_search)" << std::endl;
+        return 1;
+    }
+    std::cout << "--- Multidimensional Linear Attack (m=" << ap.size() << ", "
+              << (llr ? "LLR" : "chi^2") << ") ---" << std::endl;
+    for (const auto& a : ap)
+        std::cout << "  In=0x" << std::hex << a.maskIn << " Out=0x" << a.maskOut << std::dec
+                  << " Bias=" << a.bias << std::endl;
+
+    std::ifstream infile("linear_data.txt");
+    if (!infile.is_open()) {
+        std::cerr << "Error opening linear_data.txt!" << std::endl;
+        return 1;
+    }
+    PROFILE_STAGE(parse, "parse text");
+    std::vector<uint16_t> P, C;
+    uint16_t p_val, c_val;
+    while (infile >> std::hex >> p_val >> c_val) {
+        P.push_back(p_val);
+        C.push_back(c_val);
+    }
+    PROFILE_STAGE_END(parse, P.size());
+    PROFILE_COUNT("bytes read", profileFileSize("linear_data.txt"));
+    std::cout << "Loaded " << P.size() << " pairs." << std::endl;
+
+    MultiLinearTable table;
+    table.reset((int)ap.size());
+    multiLinearCountParallel(ap, P.data(), C.data(), P.size(), table);
+    std::vector<uint64_t> hist = multiLinearHistograms(table, ap);
+
+    std::vector<double> dist;
+    if (llr) {
+        Codebook cb;
+        if (!cb.open()) return 1;
+        dist = multiLinearDistribution(ap, cb.encTable(cb.rounds() - 1));
+    }
+    const size_t bins = (size_t)1 << table.m;
+    std::vector<std::pair<double, int>> results;
+    for (int k = 0; k < 16; ++k) {
+        const uint64_t* h = &hist[k * bins];
+        results.push_back({llr ? multiLinearLlr(h, dist) : multiLinearChi2(h, bins, table.n), k});
+    }
+    std::stable_sort(results.begin(), results.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::ofstream outfile("linear_key_guess.txt");
+    std::cout << "\nTop Key Candidates:\n";
+    for (const auto& r : results) {
+        std::cout << "Key = " << r.second << " (" << std::hex << r.second << std::dec << ") | "
+                  << (llr ? "LLR: " : "Chi2: ") << std::fixed << std::setprecision(2) << r.first
+                  << std::defaultfloat << std::endl;
+        outfile << "Key=" << r.second << (llr ? " LLR=" : " Chi2=") << r.first << "\n";
+    }
+    outfile.close();
+    std::cout << "\nResults saved to linear_key_guess.txt" << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return 1;
+    int dim = 0;
+    bool multi = false, llr = false;
+    bool multiOnly = false; // --stat / --approx без --multi — ошибка, а не тихий игнор
+    std::string approxFile = "linear_result_5_rounds.txt";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--multi") {
+            multi = true;
+            dim = 4;
+        } else if (arg.rfind("--multi=", 0) == 0) {
+            multi = true;
+            dim = std::stoi(arg.substr(8));
+        } else if (arg == "--stat=llr" || arg == "--stat=chi2") {
+            llr = arg == "--stat=llr";
+            multiOnly = true;
+        } else if (arg.rfind("--approx=", 0) == 0) {
+            approxFile = arg.substr(9);
+            multiOnly = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--multi[=m]] [--stat=chi2|llr] [--approx=FILE]"
+                      << " [--cipher=FILE] [--master=HEX]" << std::endl;
+            return 1;
+        }
+    }
+    if (multi && (dim < 1 || dim > LINEAR_MULTI_MAX_DIM)) {
+        std::cerr << "Error: --multi dimension must be in 1.." << LINEAR_MULTI_MAX_DIM << std::endl;
+        return 1;
+    }
+    if (multiOnly && !multi) {
+        std::cerr << "Error: --stat and --approx apply only to --multi" << std::endl;
+        return 1;
+    }
+    if (multi) return run_multi(dim, llr, approxFile);
     std::cout << "--- Linear Attack (Variant 5) ---" << std::endl;
     std::cout << "Target Mask IN:  0x" << std::hex << TARGET_MASK_IN << std::endl;
     std::cout << "Target Mask OUT: 0x" << TARGET_MASK_OUT << std::dec << std::endl;
 
-    // 1. Загрузка данных
-    std::vector<uint16_t> P_data;
-    std::vector<uint16_t> C_data;
-    
+    // 1. Один потоковый проход: данные сжимаются в таблицу счетчиков
+    //    по нибблам (Y1, Y2), которые трогает откат раунда
     std::ifstream infile("linear_data.txt");
     if (!infile.is_open()) {
         std::cerr << "Error opening linear_data.txt!" << std::endl;
         return 1;
     }
 
+    PROFILE_STAGE(parse, "parse and count");
+    LinearCountTable table;
     uint16_t p_val, c_val;
-    while (infile >> std::hex >> p_val >> c_val) {
-        P_data.push_back(p_val);
-        C_data.push_back(c_val);
-    }
+    while (infile >> std::hex >> p_val >> c_val)
+        linearCountPairs(&p_val, &c_val, 1, TARGET_MASK_IN, TARGET_MASK_OUT, table);
     infile.close();
+    PROFILE_STAGE_END(parse, table.n);
+    PROFILE_COUNT("bytes read", profileFileSize("linear_data.txt"));
 
-    int N = P_data.size();
+    int N = (int)table.n;
     std::cout << "Loaded " << N << " pairs." << std::endl;
 
-    // 2. Атака (перебор ключа)
+    // 2. Атака: все 16 ключей по таблице (FWHT-свертка)
+    long long matches[16];
+    linearScoreKeys(table, TARGET_MASK_OUT, matches);
     std::vector<int> scores(16, 0); // Счетчики совпадений для каждого ключа (0..15)
-
-    for (int i = 0; i < N; ++i) {
-        uint16_t P = P_data[i];
-        Block C_block = unpackBlock(C_data[i]);
-
-        // Бит уравнения от открытого текста (константа для пары)
-        uint8_t bit_P = parity(P & TARGET_MASK_IN);
-
-        for (int k = 0; k < 16; ++k) {
-            // Частичное дешифрование последнего раунда
-            Block C_prev = C_block;
-            decryptOneRound(C_prev, (uint8_t)k);
-            
-            uint16_t val_prev = packBlock(C_prev);
-
-            // Бит уравнения от выхода 5-го раунда
-            uint8_t bit_C5 = parity(val_prev & TARGET_MASK_OUT);
-
-            // Если уравнение выполняется (bit_P ^ bit_C5 == 0)
-            if ((bit_P ^ bit_C5) == 0) {
-                scores[k]++;
-            }
-        }
-    }
+    for (int k = 0; k < 16; ++k) scores[k] = (int)matches[k];
 
     // 3. Анализ результатов
     std::vector<KeyScore> results;
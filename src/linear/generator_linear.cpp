@@ -1,55 +1,121 @@
 #include "cipher_engine.h"
+#include "codebook.h"
+#include "linear_key.h"
+#include "adaptive_stop.h"
+#include "counter_rng.h"
+#include "thread_pool.h"
+#include "instrument.h"
 #include <vector>
-#include <random>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <string>
 
 // Количество пар для атаки
 // Смещения 0.125 (как мы нашли) очень сильное.
-// Теоретически N ~ 1/(bias^2) = 64. 
+// Теоретически N ~ 1/(bias^2) = 64.
 // Возьмем 50,000 с огромным запасом.
 const int NUM_PAIRS = 50000;
 
-int main() {
-    std::cout << "--- Linear Attack Data Generator (Variant 5) ---" << std::endl;
-    std::cout << "Generating " << NUM_PAIRS << " Known Plaintext-Ciphertext pairs..." << std::endl;
+// Адаптивный режим (--adaptive[=бит]): пары генерируются порциями и сразу
+// сжимаются в таблицу счетчиков атаки (linear_key.h); генерация
+// останавливается, когда оценка Сельчука по смещению лидера дает целевое
+// преимущество (adaptive_stop.h). NUM_PAIRS (или --max-pairs) — предел.
+const int ADAPTIVE_FIRST_BATCH = 16;
+
+int main(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return 1;
+    bool adaptive = false;
+    AdaptiveStop stop;
+    stop.minPairs = ADAPTIVE_FIRST_BATCH;
+    int maxPairs = NUM_PAIRS;
+    uint64_t seed = DEFAULT_DATA_SEED;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--adaptive") adaptive = true;
+        else if (arg.rfind("--adaptive=", 0) == 0) {
+            adaptive = true;
+            stop.targetAdvantage = std::stod(arg.substr(11));
+        } else if (arg.rfind("--success=", 0) == 0) stop.successProb = std::stod(arg.substr(10));
+        else if (arg.rfind("--max-pairs=", 0) == 0) maxPairs = std::stoi(arg.substr(12));
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::stoull(arg.substr(7));
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--adaptive[=BITS]] [--success=P] [--max-pairs=N]"
+                      << " [--seed=S] [--cipher=FILE] [--master=HEX]\n";
+            return 1;
+        }
+    }
+    if (maxPairs < 1) maxPairs = NUM_PAIRS;
 
-    std::vector<uint16_t> P_data(NUM_PAIRS);
-    std::vector<uint16_t> C_data(NUM_PAIRS);
+    std::cout << "--- Linear Attack Data Generator (Variant 5) ---" << std::endl;
+    if (adaptive)
+        std::cout << "Adaptive: target advantage " << stop.targetAdvantage << " bits at P_S="
+                  << stop.successProb << ", up to " << maxPairs << " pairs" << std::endl;
+    else
+        std::cout << "Generating " << maxPairs << " Known Plaintext-Ciphertext pairs..." << std::endl;
 
-    std::mt19937 rng(std::random_device{}());
-    std::uniform_int_distribution<uint16_t> dist(0, 65535);
+    std::vector<uint16_t> P_data(maxPairs);
+    std::vector<uint16_t> C_data(maxPairs);
 
-    // Можно распараллелить, но 50к это мгновенно.
-    for (int i = 0; i < NUM_PAIRS; ++i) {
-        uint16_t val = dist(rng);
-        Block b = unpackBlock(val);
-        
-        // Сохраняем открытый текст
-        P_data[i] = val;
+    // P_i — блок i счетчикового генератора: набор воспроизводим по --seed
+    const CounterRng rng(seed, RNG_STREAM_LINEAR);
 
-        // Шифруем полными 6 раундами
-        encrypt(b);
+    Codebook cb;
+    if (!cb.open()) return 1;
 
-        // Сохраняем шифротекст
-        C_data[i] = packBlock(b);
+    int numPairs = 0;
+    LinearCountTable table;
+    AdaptiveEstimate est;
+    bool reached = false;
+    int batch = adaptive ? ADAPTIVE_FIRST_BATCH : maxPairs;
+    PROFILE_STAGE(generate, "generate");
+    while (numPairs < maxPairs && !reached) {
+        batch = std::min(batch, maxPairs - numPairs);
+        parallelFor(numPairs, numPairs + batch, PARALLEL_GRAIN, [&](size_t b, size_t e, unsigned) {
+            rng.fill16(b, e - b, &P_data[b]);
+            for (size_t i = b; i < e; ++i) {
+                // Шифруем полными 6 раундами (таблица кодбука)
+                C_data[i] = cb.enc(P_data[i]);
+            }
+        });
+        if (adaptive) {
+            linearCountPairs(&P_data[numPairs], &C_data[numPairs], batch,
+                             LINEAR_TARGET_MASK_IN, LINEAR_TARGET_MASK_OUT, table);
+            long long matches[16];
+            linearScoreKeys(table, LINEAR_TARGET_MASK_OUT, matches);
+            reached = stop.linear(matches, 16, numPairs + batch, est);
+            std::cout << "  N=" << numPairs + batch << "  leader bias=" << est.eps
+                      << " (x" << est.leaders << ")  advantage=" << est.advantage << " bits"
+                      << std::endl;
+        }
+        numPairs += batch;
+        batch *= 2;
     }
+    PROFILE_STAGE_END(generate, numPairs);
+    if (adaptive && !reached && stop.targetAdvantage > tieAdvantageBound(16, est.leaders))
+        std::cout << "Target not reached (leader group of " << est.leaders
+                  << " of 16 keys: at most " << tieAdvantageBound(16, est.leaders) << " bits)" << std::endl;
+    else if (adaptive && !reached)
+        std::cout << "Target not reached (estimated need ~" << (long long)std::min(est.needed, 1e18)
+                  << " pairs)" << std::endl;
 
     // Сохранение в файл
     // Формат: Plaintext(hex) Ciphertext(hex)
+    PROFILE_STAGE(write, "write text");
     std::ofstream outfile("linear_data.txt");
     if (!outfile.is_open()) {
         std::cerr << "Error opening output file!" << std::endl;
         return 1;
     }
 
-    for (int i = 0; i < NUM_PAIRS; ++i) {
+    for (int i = 0; i < numPairs; ++i) {
         outfile << std::hex << P_data[i] << " " << C_data[i] << "\n";
     }
 
     outfile.close();
-    std::cout << "Data saved to linear_data.txt" << std::endl;
+    PROFILE_STAGE_END(write, numPairs);
+    PROFILE_COUNT("bytes written", profileFileSize("linear_data.txt"));
+    std::cout << "Saved " << numPairs << " pairs. Data saved to linear_data.txt" << std::endl;
 
     return 0;
 }
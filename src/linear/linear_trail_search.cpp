@@ -0,0 +1,313 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include "cipher_engine.h"
+#include "cipher_spec.h"
+#include "flat_hash.h"
+#include "thread_pool.h"
+#include "progress.h"
+#include "instrument.h"
+#include "lat_table.h"
+
+using namespace std;
+
+// Аналитический поиск линейных траекторий (пара к trail_search.cpp).
+// Маска v = (v0, v1, v2, v3) на входе раунда переходит в
+//   u = (v1, v2 ^ a, v3 ^ b, v0),
+// где (a, b) — входные маски приближения F с выходной маской v0,
+// корреляция раунда — c_F((a, b) -> v0) (lat_table.h); при v0 = 0 раунд
+// проходит с корреляцией 1.
+//  1. Границы: BOUND[r] — лучшая c^2 r-раундовой траектории, ветки
+//     отсекаются по c^2 * BOUND[оставшиеся раунды] (Мацуи).
+//  2. Оболочки: все траектории с c^2 не ниже порога суммируются по
+//     (alpha, beta) — ELP, средний по ключам квадрат корреляции.
+// Стартовые маски распределяются по всем ядрам.
+//
+// Выход — ранжированный список "a0 a1 a2 a3 b0 b1 b2 b3 ELP", как
+// trail_results.txt; |bias| ~ sqrt(ELP) / 2. Его читает attack_linear
+// (--approx=linear_trail_results.txt) без выборочного перебора смещений.
+//
+// Использование:
+//   ./linear_trail_search [--rounds=5] [--threshold=1e-5] [--top=50]
+//                         [--out=linear_trail_results.txt] [--cipher=FILE]
+
+LatTables L;
+
+// BOUND[r] — лучшая c^2 r-раундовой траектории, BOUND[0] = 1
+double BOUND[MAX_ROUNDS + 1];
+
+const int START_CHUNK = 256;
+
+void unpack(uint16_t val, int v[4]) {
+    for (int j = 0; j < 4; ++j) v[j] = (val >> (12 - 4 * j)) & 0xF;
+}
+
+// Раунд над упакованной маской: (v0,v1,v2,v3) -> (v1, v2^a, v3^b, v0)
+inline uint16_t next_mask(uint16_t s, int a, int b) {
+    return (uint16_t)(((s << 4) | (s >> 12)) ^ (a << 8) ^ (b << 4));
+}
+
+void atomic_max(atomic<double>& x, double v) {
+    double cur = x.load(memory_order_relaxed);
+    while (v > cur && !x.compare_exchange_weak(cur, v, memory_order_relaxed)) {}
+}
+
+struct LinearTrail {
+    double corr2 = 0.0;
+    uint16_t start = 0;
+    uint8_t a[MAX_ROUNDS] = {0};
+    uint8_t b[MAX_ROUNDS] = {0};
+};
+
+// Переходы раунда для маски s: при v0 = 0 — единственный (0, 0) с c = 1
+const FMaskTransition IDENTITY_TRANSITION = {1.0, 1.0, 0, 0};
+
+inline int transitions(uint16_t s, const FMaskTransition*& list) {
+    int m = s >> 12;
+    if (m == 0) {
+        list = &IDENTITY_TRANSITION;
+        return 1;
+    }
+    list = L.fList[m];
+    return L.fNum[m];
+}
+
+// --- 1. Лучшая траектория ---
+
+void dfs_best(int rounds, int d, uint16_t state, double c2, LinearTrail& cur, LinearTrail& best,
+              atomic<double>& global) {
+    if (d == rounds) {
+        // Равные по c^2 — меньшая стартовая маска (куски берутся не по порядку)
+        if (c2 > best.corr2 || (c2 == best.corr2 && cur.start < best.start)) {
+            best = cur;
+            best.corr2 = c2;
+        }
+        atomic_max(global, c2);
+        return;
+    }
+    // Приближения по убыванию c^2: первое отсеченное отсекает и остальные.
+    // Отсечение строгое, чтобы равная лучшей траектория с меньшим стартом
+    // не терялась (результат не зависит от потоков), как в trail_search.
+    const FMaskTransition* list;
+    int n = transitions(state, list);
+    double rest = BOUND[rounds - d - 1];
+    for (int i = 0; i < n; ++i) {
+        const FMaskTransition& t = list[i];
+        double q = c2 * t.corr2;
+        if (q * rest < global.load(memory_order_relaxed)) break;
+        cur.a[d] = t.a;
+        cur.b[d] = t.b;
+        dfs_best(rounds, d + 1, next_mask(state, t.a, t.b), q, cur, best, global);
+    }
+}
+
+LinearTrail search_best(int rounds) {
+    atomic<double> global(0.0);
+    vector<LinearTrail> best(poolThreads());
+
+    parallelFor(1, 65536, START_CHUNK, [&](size_t lo, size_t hi, unsigned tid) {
+        LinearTrail cur;
+        for (size_t s = lo; s < hi; ++s) {
+            cur.start = (uint16_t)s;
+            dfs_best(rounds, 0, (uint16_t)s, 1.0, cur, best[tid], global);
+        }
+    });
+
+    LinearTrail r;
+    for (const auto& b : best)
+        if (b.corr2 > r.corr2 || (b.corr2 == r.corr2 && b.corr2 > 0 && b.start < r.start)) r = b;
+    return r;
+}
+
+// --- 2. Перечисление траекторий выше порога (линейные оболочки) ---
+
+void dfs_enum(int rounds, int d, uint16_t start, uint16_t state, double c2, double threshold,
+              FlatHashMap<double>& acc, long long& trails) {
+    if (d == rounds) {
+        acc[((uint64_t)start << 16) | state] += c2;
+        ++trails;
+        return;
+    }
+    const FMaskTransition* list;
+    int n = transitions(state, list);
+    double rest = BOUND[rounds - d - 1];
+    for (int i = 0; i < n; ++i) {
+        const FMaskTransition& t = list[i];
+        double q = c2 * t.corr2;
+        if (q * rest < threshold) break;
+        dfs_enum(rounds, d + 1, start, next_mask(state, t.a, t.b), q, threshold, acc, trails);
+    }
+}
+
+struct Hull {
+    uint16_t maskIn;
+    uint16_t maskOut;
+    double elp;
+};
+
+bool hull_better(const Hull& a, const Hull& b) {
+    if (a.elp != b.elp) return a.elp > b.elp;
+    if (a.maskIn != b.maskIn) return a.maskIn < b.maskIn;
+    return a.maskOut < b.maskOut;
+}
+
+// Оболочки считаются по одной стартовой маске за раз, в кучу исполнителя
+// попадают только лучшие top (как enumerate_differentials)
+vector<Hull> enumerate_hulls(int rounds, double threshold, size_t top,
+                             long long& totalTrails, long long& totalHulls) {
+    unsigned numThreads = poolThreads();
+    vector<vector<Hull>> heaps(numThreads);
+    vector<unique_ptr<FlatHashMap<double>>> accs(numThreads);
+    vector<long long> trails(numThreads, 0), hulls(numThreads, 0);
+
+    ProgressMeter progress("Enumerating", 65535, "starts");
+    parallelFor(1, 65536, START_CHUNK, [&](size_t lo, size_t hi, unsigned tid) {
+        if (!accs[tid]) accs[tid].reset(new FlatHashMap<double>());
+        FlatHashMap<double>& acc = *accs[tid];
+        vector<Hull>& heap = heaps[tid];
+        for (size_t s = lo; s < hi; ++s) {
+            dfs_enum(rounds, 0, (uint16_t)s, (uint16_t)s, 1.0, threshold, acc, trails[tid]);
+            hulls[tid] += acc.size();
+            acc.forEach([&](uint64_t key, double elp) {
+                Hull e{(uint16_t)(key >> 16), (uint16_t)key, elp};
+                if (heap.size() < top) {
+                    heap.push_back(e);
+                    push_heap(heap.begin(), heap.end(), hull_better);
+                } else if (hull_better(e, heap.front())) {
+                    pop_heap(heap.begin(), heap.end(), hull_better);
+                    heap.back() = e;
+                    push_heap(heap.begin(), heap.end(), hull_better);
+                }
+            });
+            if (acc.size()) acc.clear();
+        }
+        progress.add(hi - lo);
+    });
+    progress.finish();
+
+    vector<Hull> all;
+    totalTrails = 0;
+    totalHulls = 0;
+    for (unsigned t = 0; t < numThreads; ++t) {
+        all.insert(all.end(), heaps[t].begin(), heaps[t].end());
+        totalTrails += trails[t];
+        totalHulls += hulls[t];
+    }
+    sort(all.begin(), all.end(), hull_better);
+    if (all.size() > top) all.resize(top);
+    return all;
+}
+
+// Трассировка лучшей траектории; знак корреляции — для ключей activeCipher()
+void trace_path(const LinearTrail& t, int rounds) {
+    const CipherSpec& spec = activeCipher();
+    cout << "\n--- TRACING BEST LINEAR TRAIL ---\n";
+    uint16_t s = t.start;
+    double corr = 1.0;
+    for (int r = 0; r < rounds; ++r) {
+        int v[4];
+        unpack(s, v);
+        double c = v[0] ? L.fCorr[v[0]][(t.a[r] << 4) | t.b[r]] : 1.0;
+        if (parity(t.b[r] & spec.roundKeys[r])) c = -c;
+        corr *= c;
+        cout << "Round " << r + 1 << ": mask (" << v[0] << "," << v[1] << "," << v[2] << "," << v[3]
+             << ")";
+        if (v[0])
+            cout << "  F: (a=" << (int)t.a[r] << ", b=" << (int)t.b[r] << ") -> " << v[0]
+                 << "  c_G(a->m)=" << L.sbox[t.a[r]][v[0]] << "/16  c_G(b->a)="
+                 << L.sbox[t.b[r]][t.a[r]] << "/16  c=" << c;
+        cout << "\n";
+        s = next_mask(s, t.a[r], t.b[r]);
+    }
+    int v[4];
+    unpack(s, v);
+    cout << "Output mask (" << v[0] << "," << v[1] << "," << v[2] << "," << v[3] << ")"
+         << "  trail correlation " << corr << " (bias " << corr / 2 << " with cipher keys)\n";
+}
+
+int main(int argc, char** argv) {
+    if (!parseCipherArgs(argc, argv)) return 1;
+    int rounds = 5;
+    double threshold = 1e-5;
+    size_t top = 50;
+    string outName = "linear_trail_results.txt";
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg.rfind("--rounds=", 0) == 0) rounds = stoi(arg.substr(9));
+        else if (arg.rfind("--threshold=", 0) == 0) threshold = stod(arg.substr(12));
+        else if (arg.rfind("--top=", 0) == 0) top = stoul(arg.substr(6));
+        else if (arg.rfind("--out=", 0) == 0) outName = arg.substr(6);
+        else {
+            cerr << "Usage: " << argv[0] << " [--rounds=N] [--threshold=C2] [--top=K] [--out=FILE]"
+                 << " [--cipher=FILE]\n";
+            return 1;
+        }
+    }
+    if (rounds < 1 || rounds > activeCipher().rounds) {
+        cerr << "Error: rounds must be in 1.." << activeCipher().rounds << "\n";
+        return 1;
+    }
+
+    buildLatTables(L);
+
+    unsigned numThreads = poolThreads();
+
+    cout << "Starting Linear Branch-and-Bound Search (" << rounds << " rounds, "
+         << numThreads << " threads)" << endl;
+
+    // 1. Границы Мацуи для r = 1..rounds
+    auto t0 = chrono::steady_clock::now();
+    PROFILE_STAGE(bounds, "bounds");
+    BOUND[0] = 1.0;
+    vector<LinearTrail> bestByRound(rounds + 1);
+    for (int r = 1; r <= rounds; ++r) {
+        bestByRound[r] = search_best(r);
+        BOUND[r] = bestByRound[r].corr2;
+        cout << "Round " << r << " bound: best trail c^2=" << BOUND[r]
+             << " (start mask=" << hex << bestByRound[r].start << dec << ")\n";
+    }
+    PROFILE_STAGE_END(bounds, rounds);
+    double boundSec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    // 2. Оболочки: все траектории с c^2 >= threshold
+    t0 = chrono::steady_clock::now();
+    long long trails = 0, hullCount = 0;
+    PROFILE_STAGE(enumerate, "enumerate");
+    vector<Hull> hulls = enumerate_hulls(rounds, threshold, top, trails, hullCount);
+    PROFILE_STAGE_END(enumerate, 65535);
+    PROFILE_COUNT("map inserts", trails);
+    double enumSec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    cout << "Enumerated " << trails << " trails with c^2 >= " << threshold
+         << " into " << hullCount << " hulls" << endl;
+    cout << "Time: bounds " << fixed << setprecision(2) << boundSec << " s, hulls "
+         << enumSec << " s" << defaultfloat << setprecision(6) << endl;
+
+    cout << "\n--- TOP LINEAR HULLS (" << rounds << " Rounds) ---\n";
+    ofstream out(outName);
+    for (size_t i = 0; i < top && i < hulls.size(); ++i) {
+        int in[4], o[4];
+        unpack(hulls[i].maskIn, in);
+        unpack(hulls[i].maskOut, o);
+        if (i < 5) {
+            cout << i + 1 << ") In=" << hex << hulls[i].maskIn << " Out=" << hulls[i].maskOut << dec
+                 << " ELP=" << hulls[i].elp << " |bias|~" << sqrt(hulls[i].elp) / 2 << "\n";
+        }
+        out << in[0] << " " << in[1] << " " << in[2] << " " << in[3] << " "
+            << o[0] << " " << o[1] << " " << o[2] << " " << o[3] << " " << hulls[i].elp << "\n";
+    }
+    out.close();
+    cout << "Saved to " << outName << endl;
+
+    trace_path(bestByRound[rounds], rounds);
+
+    return 0;
+}